@@ -0,0 +1,64 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/handles/koid_cache.h"
+
+#include <magenta/syscalls.h>
+#include <magenta/syscalls/object.h>
+
+namespace mtl {
+
+KoidCache::KoidCache() {}
+
+KoidCache::~KoidCache() {}
+
+mx_koid_t KoidCache::GetKoid(mx_handle_t handle) {
+  Koids koids;
+  return Lookup(handle, &koids) ? koids.koid : MX_KOID_INVALID;
+}
+
+mx_koid_t KoidCache::GetRelatedKoid(mx_handle_t handle) {
+  Koids koids;
+  return Lookup(handle, &koids) ? koids.related_koid : MX_KOID_INVALID;
+}
+
+void KoidCache::Remove(mx_handle_t handle) {
+  ftl::MutexLocker locker(&mutex_);
+  koids_.erase(handle);
+}
+
+void KoidCache::Clear() {
+  ftl::MutexLocker locker(&mutex_);
+  koids_.clear();
+}
+
+size_t KoidCache::size() const {
+  ftl::MutexLocker locker(&mutex_);
+  return koids_.size();
+}
+
+bool KoidCache::Lookup(mx_handle_t handle, Koids* koids) {
+  {
+    ftl::MutexLocker locker(&mutex_);
+    auto it = koids_.find(handle);
+    if (it != koids_.end()) {
+      *koids = it->second;
+      return true;
+    }
+  }
+
+  mx_info_handle_basic_t info;
+  mx_status_t status = mx_object_get_info(handle, MX_INFO_HANDLE_BASIC, &info,
+                                          sizeof(info), nullptr, nullptr);
+  if (status != MX_OK)
+    return false;
+
+  koids->koid = info.koid;
+  koids->related_koid = info.related_koid;
+  ftl::MutexLocker locker(&mutex_);
+  koids_.emplace(handle, *koids);
+  return true;
+}
+
+}  // namespace mtl
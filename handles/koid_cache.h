@@ -0,0 +1,61 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_MTL_HANDLES_KOID_CACHE_H_
+#define LIB_MTL_HANDLES_KOID_CACHE_H_
+
+#include <magenta/types.h>
+
+#include <unordered_map>
+
+#include "lib/ftl/ftl_export.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/synchronization/mutex.h"
+#include "lib/ftl/synchronization/thread_annotations.h"
+
+namespace mtl {
+
+// Remembers the koids of long-lived handles so that repeated lookups do not
+// each cost a syscall.
+//
+// Handle values are reused once closed, so callers must |Remove| a handle
+// from the cache before closing it.
+//
+// This object is thread-safe.
+class FTL_EXPORT KoidCache {
+ public:
+  KoidCache();
+  ~KoidCache();
+
+  // Like |mtl::GetKoid| and |mtl::GetRelatedKoid|. Both koids are fetched by
+  // the first lookup of either. Failed lookups are not cached.
+  mx_koid_t GetKoid(mx_handle_t handle);
+  mx_koid_t GetRelatedKoid(mx_handle_t handle);
+
+  // Forgets |handle|.
+  void Remove(mx_handle_t handle);
+
+  // Forgets all handles.
+  void Clear();
+
+  size_t size() const;
+
+ private:
+  struct Koids {
+    mx_koid_t koid;
+    mx_koid_t related_koid;
+  };
+
+  // Returns false if the handle is invalid.
+  bool Lookup(mx_handle_t handle, Koids* koids);
+
+  mutable ftl::Mutex mutex_;
+  std::unordered_map<mx_handle_t, Koids> koids_ FTL_GUARDED_BY(mutex_);
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(KoidCache);
+};
+
+}  // namespace mtl
+
+#endif  // LIB_MTL_HANDLES_KOID_CACHE_H_
@@ -0,0 +1,50 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/handles/koid_cache.h"
+
+#include <mx/channel.h>
+#include <mx/event.h>
+
+#include "gtest/gtest.h"
+#include "lib/mtl/handles/object_info.h"
+
+namespace mtl {
+namespace {
+
+TEST(KoidCache, InvalidHandle) {
+  KoidCache cache;
+  EXPECT_EQ(MX_KOID_INVALID, cache.GetKoid(MX_HANDLE_INVALID));
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST(KoidCache, MatchesUncachedLookups) {
+  mx::channel channel1, channel2;
+  ASSERT_EQ(MX_OK, mx::channel::create(0u, &channel1, &channel2));
+
+  KoidCache cache;
+  EXPECT_EQ(GetKoid(channel1.get()), cache.GetKoid(channel1.get()));
+  EXPECT_EQ(GetRelatedKoid(channel1.get()),
+            cache.GetRelatedKoid(channel1.get()));
+  EXPECT_EQ(GetKoid(channel2.get()), cache.GetRelatedKoid(channel1.get()));
+  EXPECT_EQ(1u, cache.size());
+}
+
+TEST(KoidCache, Remove) {
+  mx::event event;
+  ASSERT_EQ(MX_OK, mx::event::create(0u, &event));
+
+  KoidCache cache;
+  EXPECT_NE(MX_KOID_INVALID, cache.GetKoid(event.get()));
+  EXPECT_EQ(1u, cache.size());
+  cache.Remove(event.get());
+  EXPECT_EQ(0u, cache.size());
+
+  EXPECT_NE(MX_KOID_INVALID, cache.GetKoid(event.get()));
+  cache.Clear();
+  EXPECT_EQ(0u, cache.size());
+}
+
+}  // namespace
+}  // namespace mtl
@@ -8,6 +8,7 @@
 #include <magenta/syscalls.h>
 #include <magenta/syscalls/object.h>
 #include <magenta/threads.h>
+#include <string.h>
 
 namespace mtl {
 
@@ -37,8 +38,50 @@ mx_status_t SetObjectName(mx_handle_t handle, const std::string& name) {
                                 name.size());
 }
 
+void GetObjectInfos(const mx_handle_t* handles,
+                    size_t count,
+                    bool include_names,
+                    std::vector<ObjectInfo>* infos) {
+  // The kernel has no batched query, but a single basic info query covers
+  // everything except the name.
+  infos->resize(count);
+  for (size_t i = 0; i < count; i++) {
+    ObjectInfo& info = (*infos)[i];
+    mx_info_handle_basic_t basic;
+    info.status = mx_object_get_info(handles[i], MX_INFO_HANDLE_BASIC, &basic,
+                                     sizeof(basic), nullptr, nullptr);
+    if (info.status != MX_OK) {
+      info.koid = MX_KOID_INVALID;
+      info.related_koid = MX_KOID_INVALID;
+      info.type = 0u;
+      info.rights = 0u;
+      info.name.clear();
+      continue;
+    }
+    info.koid = basic.koid;
+    info.related_koid = basic.related_koid;
+    info.type = basic.type;
+    info.rights = basic.rights;
+
+    if (include_names) {
+      char name[MX_MAX_NAME_LEN];
+      if (mx_object_get_property(handles[i], MX_PROP_NAME, name,
+                                 sizeof(name)) == MX_OK) {
+        // Assigning reuses the string's existing buffer.
+        info.name.assign(name, strnlen(name, sizeof(name)));
+      } else {
+        info.name.clear();
+      }
+    } else {
+      info.name.clear();
+    }
+  }
+}
+
 mx_koid_t GetCurrentProcessKoid() {
-  return GetKoid(mx_process_self());
+  // A process's koid never changes, so look it up once.
+  static const mx_koid_t koid = GetKoid(mx_process_self());
+  return koid;
 }
 
 std::string GetCurrentProcessName() {
@@ -46,7 +89,10 @@ std::string GetCurrentProcessName() {
 }
 
 mx_koid_t GetCurrentThreadKoid() {
-  return GetKoid(thrd_get_mx_handle(thrd_current()));
+  static thread_local mx_koid_t koid = MX_KOID_INVALID;
+  if (koid == MX_KOID_INVALID)
+    koid = GetKoid(thrd_get_mx_handle(thrd_current()));
+  return koid;
 }
 
 std::string GetCurrentThreadName() {
@@ -9,6 +9,7 @@
 #include <magenta/types.h>
 
 #include <string>
+#include <vector>
 
 #include "lib/ftl/ftl_export.h"
 
@@ -33,13 +34,40 @@ FTL_EXPORT std::string GetObjectName(mx_handle_t handle);
 FTL_EXPORT mx_status_t SetObjectName(mx_handle_t handle,
                                      const std::string& name);
 
+// Information about the object associated with a handle, as returned by
+// |GetObjectInfos|.
+struct ObjectInfo {
+  // The result of querying the handle. The other fields are only meaningful
+  // when this is |MX_OK|.
+  mx_status_t status = MX_OK;
+  mx_koid_t koid = MX_KOID_INVALID;
+  // See |GetRelatedKoid|.
+  mx_koid_t related_koid = MX_KOID_INVALID;
+  uint32_t type = 0u;
+  mx_rights_t rights = 0u;
+  // Only filled in when requested.
+  std::string name;
+};
+
+// Gets information about the objects associated with |count| handles.
+//
+// |infos| is resized to |count| with one entry per handle, in order. Reuse
+// the same vector across calls to avoid reallocating it and the names.
+// Looking up names costs an extra syscall per handle, so it is optional.
+FTL_EXPORT void GetObjectInfos(const mx_handle_t* handles,
+                               size_t count,
+                               bool include_names,
+                               std::vector<ObjectInfo>* infos);
+
 // Gets the kernel object id of the current process.
+// The koid is looked up once per process.
 FTL_EXPORT mx_koid_t GetCurrentProcessKoid();
 
 // Gets the current process name.
 FTL_EXPORT std::string GetCurrentProcessName();
 
 // Gets the kernel object id of the current thread.
+// The koid is looked up once per thread.
 FTL_EXPORT mx_koid_t GetCurrentThreadKoid();
 
 // Gets the current thread name.
@@ -0,0 +1,161 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/handles/object_info.h"
+
+#include <magenta/threads.h>
+#include <mx/channel.h>
+#include <mx/event.h>
+
+#include <utility>
+#include <vector>
+
+#include "lib/mtl/handles/koid_cache.h"
+#include "lib/mtl/test/benchmark.h"
+
+namespace mtl {
+namespace {
+
+using benchmark::State;
+
+// The syscall which |GetCurrentThreadKoid| used to make on every call.
+void UncachedCurrentThreadKoid(State* state) {
+  mx_handle_t thread = thrd_get_mx_handle(thrd_current());
+  while (state->KeepRunning()) {
+    if (GetKoid(thread) == MX_KOID_INVALID) {
+      state->SkipWithError("GetKoid failed");
+      break;
+    }
+  }
+  state->SetItemsProcessed(state->iterations());
+}
+MTL_BENCHMARK(UncachedCurrentThreadKoid);
+
+void CurrentThreadKoid(State* state) {
+  while (state->KeepRunning()) {
+    if (GetCurrentThreadKoid() == MX_KOID_INVALID) {
+      state->SkipWithError("GetCurrentThreadKoid failed");
+      break;
+    }
+  }
+  state->SetItemsProcessed(state->iterations());
+}
+MTL_BENCHMARK(CurrentThreadKoid);
+
+void CurrentProcessKoid(State* state) {
+  while (state->KeepRunning()) {
+    if (GetCurrentProcessKoid() == MX_KOID_INVALID) {
+      state->SkipWithError("GetCurrentProcessKoid failed");
+      break;
+    }
+  }
+  state->SetItemsProcessed(state->iterations());
+}
+MTL_BENCHMARK(CurrentProcessKoid);
+
+void UncachedHandleKoid(State* state) {
+  mx::event event;
+  if (mx::event::create(0u, &event) != MX_OK) {
+    state->SkipWithError("Failed to create event");
+    return;
+  }
+  while (state->KeepRunning()) {
+    if (GetKoid(event.get()) == MX_KOID_INVALID) {
+      state->SkipWithError("GetKoid failed");
+      break;
+    }
+  }
+  state->SetItemsProcessed(state->iterations());
+}
+MTL_BENCHMARK(UncachedHandleKoid);
+
+void CachedHandleKoid(State* state) {
+  mx::event event;
+  if (mx::event::create(0u, &event) != MX_OK) {
+    state->SkipWithError("Failed to create event");
+    return;
+  }
+  KoidCache cache;
+  while (state->KeepRunning()) {
+    if (cache.GetKoid(event.get()) == MX_KOID_INVALID) {
+      state->SkipWithError("KoidCache::GetKoid failed");
+      break;
+    }
+  }
+  state->SetItemsProcessed(state->iterations());
+}
+MTL_BENCHMARK(CachedHandleKoid);
+
+// Creates |range| channels and snapshots their koids and peer koids, as a
+// diagnostics dump would.
+class ChannelSet {
+ public:
+  explicit ChannelSet(size_t count) {
+    for (size_t i = 0; i < count; i++) {
+      mx::channel channel1, channel2;
+      if (mx::channel::create(0u, &channel1, &channel2) != MX_OK)
+        return;
+      handles_.push_back(channel1.get());
+      channels_.push_back(std::move(channel1));
+      channels_.push_back(std::move(channel2));
+    }
+  }
+
+  bool ok(size_t count) const { return handles_.size() == count; }
+  const std::vector<mx_handle_t>& handles() const { return handles_; }
+
+ private:
+  std::vector<mx::channel> channels_;
+  std::vector<mx_handle_t> handles_;
+};
+
+void PerHandleKoids(State* state) {
+  ChannelSet channels(state->range());
+  if (!channels.ok(state->range())) {
+    state->SkipWithError("Failed to create channels");
+    return;
+  }
+  std::vector<std::pair<mx_koid_t, mx_koid_t>> koids(state->range());
+  while (state->KeepRunning()) {
+    for (size_t i = 0; i < channels.handles().size(); i++) {
+      koids[i].first = GetKoid(channels.handles()[i]);
+      koids[i].second = GetRelatedKoid(channels.handles()[i]);
+    }
+  }
+  state->SetItemsProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(PerHandleKoids, 10000);
+
+void BatchedObjectInfos(State* state) {
+  ChannelSet channels(state->range());
+  if (!channels.ok(state->range())) {
+    state->SkipWithError("Failed to create channels");
+    return;
+  }
+  std::vector<ObjectInfo> infos;
+  while (state->KeepRunning()) {
+    GetObjectInfos(channels.handles().data(), channels.handles().size(),
+                   false, &infos);
+  }
+  state->SetItemsProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(BatchedObjectInfos, 10000);
+
+void BatchedObjectInfosWithNames(State* state) {
+  ChannelSet channels(state->range());
+  if (!channels.ok(state->range())) {
+    state->SkipWithError("Failed to create channels");
+    return;
+  }
+  std::vector<ObjectInfo> infos;
+  while (state->KeepRunning()) {
+    GetObjectInfos(channels.handles().data(), channels.handles().size(), true,
+                   &infos);
+  }
+  state->SetItemsProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(BatchedObjectInfosWithNames, 10000);
+
+}  // namespace
+}  // namespace mtl
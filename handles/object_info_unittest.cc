@@ -5,6 +5,7 @@
 #include "lib/mtl/handles/object_info.h"
 
 #include <thread>
+#include <vector>
 
 #include <magenta/process.h>
 #include <magenta/syscalls/object.h>
@@ -57,6 +58,39 @@ TEST(ObjectInfo, GetRelatedKoidOfEvent) {
   EXPECT_EQ(MX_KOID_INVALID, GetRelatedKoid(event1.get()));
 }
 
+TEST(ObjectInfo, GetObjectInfos) {
+  mx::channel channel1, channel2;
+  ASSERT_EQ(MX_OK, mx::channel::create(0u, &channel1, &channel2));
+  mx::event event;
+  ASSERT_EQ(MX_OK, mx::event::create(0u, &event));
+  ASSERT_EQ(MX_OK, SetObjectName(event.get(), "event"));
+
+  const mx_handle_t handles[] = {channel1.get(), MX_HANDLE_INVALID,
+                                 event.get()};
+  std::vector<ObjectInfo> infos;
+  GetObjectInfos(handles, 3u, true, &infos);
+  ASSERT_EQ(3u, infos.size());
+
+  EXPECT_EQ(MX_OK, infos[0].status);
+  EXPECT_EQ(GetKoid(channel1.get()), infos[0].koid);
+  EXPECT_EQ(GetKoid(channel2.get()), infos[0].related_koid);
+
+  EXPECT_NE(MX_OK, infos[1].status);
+  EXPECT_EQ(MX_KOID_INVALID, infos[1].koid);
+
+  EXPECT_EQ(MX_OK, infos[2].status);
+  EXPECT_EQ(GetKoid(event.get()), infos[2].koid);
+  EXPECT_EQ(MX_KOID_INVALID, infos[2].related_koid);
+  EXPECT_EQ("event", infos[2].name);
+  EXPECT_NE(infos[0].type, infos[2].type);
+
+  // Reusing the vector without names clears them.
+  GetObjectInfos(handles + 2, 1u, false, &infos);
+  ASSERT_EQ(1u, infos.size());
+  EXPECT_EQ(GetKoid(event.get()), infos[0].koid);
+  EXPECT_EQ("", infos[0].name);
+}
+
 TEST(ObjectInfo, GetNameOfInvalidHandle) {
   EXPECT_EQ(std::string(), GetObjectName(MX_HANDLE_INVALID));
 }
@@ -67,6 +101,7 @@ TEST(ObjectInfo, SetNameOfInvalidHandle) {
 
 TEST(ObjectInfo, GetCurrentProcessKoid) {
   EXPECT_NE(MX_KOID_INVALID, GetCurrentProcessKoid());
+  EXPECT_EQ(GetKoid(mx_process_self()), GetCurrentProcessKoid());
 }
 
 TEST(ObjectInfo, GetAndSetNameOfCurrentProcess) {
@@ -91,6 +126,8 @@ TEST(ObjectInfo, GetCurrentThreadKoid) {
 
   EXPECT_NE(MX_KOID_INVALID, thread_koid);
   EXPECT_NE(self_koid, thread_koid);
+  EXPECT_EQ(self_koid, GetCurrentThreadKoid());
+  EXPECT_EQ(GetKoid(thrd_get_mx_handle(thrd_current())), self_koid);
 }
 
 TEST(ObjectInfo, GetAndSetNameOfCurrentThread) {
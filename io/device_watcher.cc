@@ -16,24 +16,89 @@ namespace mtl {
 
 DeviceWatcher::DeviceWatcher(ftl::UniqueFD dir_fd,
                              mx::channel dir_watch,
-                             Callback callback)
+                             MessageLoop* message_loop)
     : dir_fd_(std::move(dir_fd)),
       dir_watch_(std::move(dir_watch)),
-      callback_(std::move(callback)),
+      message_loop_(message_loop),
       weak_ptr_factory_(this) {
-  MessageLoop* message_loop = MessageLoop::GetCurrent();
-  FTL_DCHECK(message_loop);
+  FTL_DCHECK(message_loop_);
+  FTL_DCHECK(message_loop_ == MessageLoop::GetCurrent());
 
-  handler_key_ = message_loop->AddHandler(
+  handler_key_ = message_loop_->AddHandler(
       this, dir_watch_.get(), MX_CHANNEL_READABLE | MX_CHANNEL_PEER_CLOSED);
 }
 
 DeviceWatcher::~DeviceWatcher() {
-  MessageLoop::GetCurrent()->RemoveHandler(handler_key_);
+  message_loop_->RemoveHandler(handler_key_);
 }
 
 std::unique_ptr<DeviceWatcher> DeviceWatcher::Create(std::string directory_path,
                                                      Callback callback) {
+  return Create(std::move(directory_path), std::move(callback),
+                MessageLoop::GetCurrent());
+}
+
+std::unique_ptr<DeviceWatcher> DeviceWatcher::Create(
+    std::string directory_path,
+    Callback callback,
+    MessageLoop* message_loop) {
+  auto watcher =
+      CreateInternal(std::move(directory_path),
+                     VFS_WATCH_MASK_ADDED | VFS_WATCH_MASK_EXISTING,
+                     message_loop);
+  if (watcher)
+    watcher->callback_ = std::move(callback);
+  return watcher;
+}
+
+std::unique_ptr<DeviceWatcher> DeviceWatcher::CreateBatched(
+    std::string directory_path,
+    BatchCallback callback) {
+  return CreateBatched(std::move(directory_path), std::move(callback),
+                       MessageLoop::GetCurrent());
+}
+
+std::unique_ptr<DeviceWatcher> DeviceWatcher::CreateBatched(
+    std::string directory_path,
+    BatchCallback callback,
+    MessageLoop* message_loop) {
+  auto watcher =
+      CreateInternal(std::move(directory_path),
+                     VFS_WATCH_MASK_ADDED | VFS_WATCH_MASK_EXISTING,
+                     message_loop);
+  if (watcher)
+    watcher->batch_callback_ = std::move(callback);
+  return watcher;
+}
+
+std::unique_ptr<DeviceWatcher> DeviceWatcher::CreateWithEvents(
+    std::string directory_path,
+    EventOptions options,
+    EventCallback callback) {
+  return CreateWithEvents(std::move(directory_path), options,
+                          std::move(callback), MessageLoop::GetCurrent());
+}
+
+std::unique_ptr<DeviceWatcher> DeviceWatcher::CreateWithEvents(
+    std::string directory_path,
+    EventOptions options,
+    EventCallback callback,
+    MessageLoop* message_loop) {
+  auto watcher = CreateInternal(std::move(directory_path),
+                                VFS_WATCH_MASK_ADDED | VFS_WATCH_MASK_EXISTING |
+                                    VFS_WATCH_MASK_REMOVED,
+                                message_loop);
+  if (watcher) {
+    watcher->event_callback_ = std::move(callback);
+    watcher->debounce_ = options.debounce;
+  }
+  return watcher;
+}
+
+std::unique_ptr<DeviceWatcher> DeviceWatcher::CreateInternal(
+    std::string directory_path,
+    uint32_t mask,
+    MessageLoop* message_loop) {
   // Open the directory.
   int open_result = open(directory_path.c_str(), O_DIRECTORY | O_RDONLY);
   if (open_result < 0) {
@@ -45,7 +110,7 @@ std::unique_ptr<DeviceWatcher> DeviceWatcher::Create(std::string directory_path,
 
   // Create the directory watch channel.
   vfs_watch_dir_t wd;
-  wd.mask = VFS_WATCH_MASK_ADDED | VFS_WATCH_MASK_EXISTING;
+  wd.mask = mask;
   wd.options = 0;
   mx_handle_t dir_watch_handle;
   if (mx_channel_create(0, &wd.channel, &dir_watch_handle) < 0) {
@@ -61,40 +126,32 @@ std::unique_ptr<DeviceWatcher> DeviceWatcher::Create(std::string directory_path,
   }
   mx::channel dir_watch(dir_watch_handle);  // take ownership of handle here
 
-  return std::unique_ptr<DeviceWatcher>(new DeviceWatcher(
-      std::move(dir_fd), std::move(dir_watch), std::move(callback)));
+  return std::unique_ptr<DeviceWatcher>(
+      new DeviceWatcher(std::move(dir_fd), std::move(dir_watch),
+                        message_loop));
 }
 
 void DeviceWatcher::OnHandleReady(mx_handle_t handle,
                                   mx_signals_t pending,
                                   uint64_t count) {
   if (pending & MX_CHANNEL_READABLE) {
-    uint32_t size;
+    std::vector<ftl::StringView> filenames;
     uint8_t buf[VFS_WATCH_MSG_MAX];
-    mx_status_t status =
-        dir_watch_.read(0, buf, sizeof(buf), &size, nullptr, 0, nullptr);
-    FTL_CHECK(status == MX_OK)
-        << "Failed to read from directory watch channel";
-
-    auto weak = weak_ptr_factory_.GetWeakPtr();
-    uint8_t* msg = buf;
-    while (size >= 2) {
-        unsigned event = *msg++;
-        unsigned namelen = *msg++;
-        if (size < (namelen + 2u)) {
-            break;
-        }
-        if ((event == VFS_WATCH_EVT_ADDED) || (event == VFS_WATCH_EVT_EXISTING)) {
-            callback_(dir_fd_.get(), std::string(reinterpret_cast<char*>(msg), namelen));
-            // Note: Callback may have destroyed the DeviceWatcher before returning.
-            if (!weak) {
-                break;
-            }
-        }
-        msg += namelen;
-        size -= namelen;
+    // Drain every pending message, so that a burst of devices such as the
+    // initial enumeration is handled in a single wakeup.
+    for (;;) {
+      uint32_t size;
+      mx_status_t status =
+          dir_watch_.read(0, buf, sizeof(buf), &size, nullptr, 0, nullptr);
+      // If the peer is gone, the next wakeup reports it.
+      if (status == MX_ERR_SHOULD_WAIT || status == MX_ERR_PEER_CLOSED)
+        return;
+      FTL_CHECK(status == MX_OK)
+          << "Failed to read from directory watch channel";
+
+      if (!DispatchMessage(buf, size, &filenames))
+        return;
     }
-    return;
   }
 
   if (pending & MX_CHANNEL_PEER_CLOSED) {
@@ -106,4 +163,99 @@ void DeviceWatcher::OnHandleReady(mx_handle_t handle,
   FTL_CHECK(false);
 }
 
+bool DeviceWatcher::DispatchMessage(const uint8_t* msg,
+                                    uint32_t size,
+                                    std::vector<ftl::StringView>* filenames) {
+  // Each entry is an event byte and a name length byte followed by the name.
+  filenames->clear();
+  while (size >= 2u) {
+    unsigned event = *msg++;
+    unsigned namelen = *msg++;
+    size -= 2u;
+    if (size < namelen)
+      break;
+    ftl::StringView filename(reinterpret_cast<const char*>(msg), namelen);
+    if ((event == VFS_WATCH_EVT_ADDED) || (event == VFS_WATCH_EVT_EXISTING)) {
+      if (event_callback_)
+        AddEvent(Event::Type::kAdded, filename);
+      else
+        filenames->push_back(filename);
+    } else if (event == VFS_WATCH_EVT_REMOVED && event_callback_) {
+      AddEvent(Event::Type::kRemoved, filename);
+    }
+    msg += namelen;
+    size -= namelen;
+  }
+
+  if (event_callback_) {
+    if (pending_events_.empty())
+      return true;
+    if (debounce_ <= ftl::TimeDelta::Zero())
+      return FlushEvents();
+    if (!flush_scheduled_) {
+      flush_scheduled_ = true;
+      auto weak = weak_ptr_factory_.GetWeakPtr();
+      message_loop_->task_runner()->PostDelayedTask(
+          [weak] {
+            if (weak)
+              weak->FlushEvents();
+          },
+          debounce_);
+    }
+    return true;
+  }
+
+  if (filenames->empty())
+    return true;
+
+  // Note: Callbacks may destroy the DeviceWatcher before returning.
+  auto weak = weak_ptr_factory_.GetWeakPtr();
+  if (batch_callback_) {
+    batch_callback_(dir_fd_.get(), *filenames);
+    return !!weak;
+  }
+  for (const ftl::StringView& filename : *filenames) {
+    callback_(dir_fd_.get(), filename.ToString());
+    if (!weak)
+      return false;
+  }
+  return true;
+}
+
+void DeviceWatcher::AddEvent(Event::Type type, ftl::StringView filename) {
+  std::string name = filename.ToString();
+  std::vector<size_t>& indices = pending_event_indices_[name];
+  if (!indices.empty()) {
+    PendingEvent& last = pending_events_[indices.back()];
+    if (last.event.type == type)
+      return;
+    if (last.event.type == Event::Type::kAdded) {
+      // The device came and went within the batch.
+      last.cancelled = true;
+      indices.pop_back();
+      return;
+    }
+  }
+  indices.push_back(pending_events_.size());
+  pending_events_.push_back(PendingEvent{Event{type, std::move(name)}, false});
+}
+
+bool DeviceWatcher::FlushEvents() {
+  flush_scheduled_ = false;
+  std::vector<Event> events;
+  for (PendingEvent& pending : pending_events_) {
+    if (!pending.cancelled)
+      events.push_back(std::move(pending.event));
+  }
+  pending_events_.clear();
+  pending_event_indices_.clear();
+  if (events.empty())
+    return true;
+
+  // Note: The callback may destroy the DeviceWatcher before returning.
+  auto weak = weak_ptr_factory_.GetWeakPtr();
+  event_callback_(dir_fd_.get(), events);
+  return !!weak;
+}
+
 }  // namespace mtl
@@ -10,11 +10,15 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "lib/ftl/files/unique_fd.h"
 #include "lib/ftl/ftl_export.h"
 #include "lib/ftl/macros.h"
 #include "lib/ftl/memory/weak_ptr.h"
+#include "lib/ftl/strings/string_view.h"
+#include "lib/ftl/time/time_delta.h"
 #include "lib/mtl/tasks/message_loop.h"
 #include "lib/mtl/tasks/message_loop_handler.h"
 
@@ -22,8 +26,7 @@ namespace mtl {
 
 // Watches for devices to be registered in devfs.
 //
-// TODO(jeffbrown): Generalize to watching arbitrary directories or dealing
-// with removal when mxio has a protocol for it.
+// TODO(jeffbrown): Generalize to watching arbitrary directories.
 class FTL_EXPORT DeviceWatcher : private mtl::MessageLoopHandler {
  public:
   // Callback function which is invoked whenever a device is found.
@@ -31,6 +34,42 @@ class FTL_EXPORT DeviceWatcher : private mtl::MessageLoopHandler {
   // |filename| is the name of the file relative to the directory.
   using Callback = std::function<void(int dir_fd, std::string filename)>;
 
+  // Callback function which is invoked with the names of all devices found
+  // in one message from the directory watch channel. The names are only
+  // valid for the duration of the call.
+  using BatchCallback =
+      std::function<void(int dir_fd,
+                         const std::vector<ftl::StringView>& filenames)>;
+
+  // A device appearing in or disappearing from the directory.
+  struct Event {
+    enum class Type {
+      // The device exists, either when the watcher is created or since.
+      kAdded,
+      kRemoved,
+    };
+
+    Type type;
+    std::string filename;
+  };
+
+  // Callback function which is invoked with a batch of device events.
+  using EventCallback =
+      std::function<void(int dir_fd, const std::vector<Event>& events)>;
+
+  struct EventOptions {
+    // Events arriving within this window of the first event of a batch are
+    // delivered together. A burst of hotplug activity then causes one
+    // callback rather than many. Zero delivers each watch message as its own
+    // batch.
+    //
+    // Within a batch, repeated events for a device are reported once, and a
+    // device which is added then removed is not reported at all. A device
+    // which is removed then added again is reported as both, since it may
+    // have been replaced.
+    ftl::TimeDelta debounce = ftl::TimeDelta::Zero();
+  };
+
   ~DeviceWatcher();
 
   // Creates a device watcher associated with the current message loop.
@@ -41,10 +80,62 @@ class FTL_EXPORT DeviceWatcher : private mtl::MessageLoopHandler {
   static std::unique_ptr<DeviceWatcher> Create(std::string directory_path,
                                                Callback callback);
 
+  // Like |Create| but associates the watcher with |message_loop|, which must
+  // belong to the current thread and outlive the watcher.
+  static std::unique_ptr<DeviceWatcher> Create(std::string directory_path,
+                                               Callback callback,
+                                               MessageLoop* message_loop);
+
+  // Like |Create| but delivers devices in batches, which avoids a string
+  // allocation and a callback per device when many are present, as during
+  // boot.
+  static std::unique_ptr<DeviceWatcher> CreateBatched(
+      std::string directory_path,
+      BatchCallback callback);
+  static std::unique_ptr<DeviceWatcher> CreateBatched(
+      std::string directory_path,
+      BatchCallback callback,
+      MessageLoop* message_loop);
+
+  // Like |CreateBatched| but also reports devices which are removed, and
+  // optionally coalesces events as described by |EventOptions|.
+  static std::unique_ptr<DeviceWatcher> CreateWithEvents(
+      std::string directory_path,
+      EventOptions options,
+      EventCallback callback);
+  static std::unique_ptr<DeviceWatcher> CreateWithEvents(
+      std::string directory_path,
+      EventOptions options,
+      EventCallback callback,
+      MessageLoop* message_loop);
+
  private:
-  DeviceWatcher(ftl::UniqueFD dir_fd, mx::channel dir_watch, Callback callback);
+  friend class DeviceWatcherTest;
+
+  DeviceWatcher(ftl::UniqueFD dir_fd,
+                mx::channel dir_watch,
+                MessageLoop* message_loop);
+
+  // Opens a watch on |directory_path| for the events in |mask|. The caller
+  // sets exactly one callback on the result.
+  static std::unique_ptr<DeviceWatcher> CreateInternal(
+      std::string directory_path,
+      uint32_t mask,
+      MessageLoop* message_loop);
+
+  // Delivers the devices named in one watch message, using |filenames| as
+  // scratch space. Returns false if a callback destroyed the watcher.
+  bool DispatchMessage(const uint8_t* msg,
+                       uint32_t size,
+                       std::vector<ftl::StringView>* filenames);
 
-  static void ListDevices(ftl::WeakPtr<DeviceWatcher> weak, int dir_fd);
+  // Records an event for |filename|, coalescing it with the pending events
+  // for the same device as described by |EventOptions|.
+  void AddEvent(Event::Type type, ftl::StringView filename);
+
+  // Delivers the pending events. Returns false if the callback destroyed the
+  // watcher.
+  bool FlushEvents();
 
   // |MessageLoopHandler|:
   void OnHandleReady(mx_handle_t handle,
@@ -53,7 +144,26 @@ class FTL_EXPORT DeviceWatcher : private mtl::MessageLoopHandler {
 
   ftl::UniqueFD dir_fd_;
   mx::channel dir_watch_;
+  // Exactly one of these is set.
   Callback callback_;
+  BatchCallback batch_callback_;
+  EventCallback event_callback_;
+
+  struct PendingEvent {
+    Event event;
+    // Set when a later event cancels this one.
+    bool cancelled;
+  };
+
+  ftl::TimeDelta debounce_;
+  std::vector<PendingEvent> pending_events_;
+  // Maps file names to the indices in |pending_events_| of their events which
+  // are not cancelled, oldest first. There are at most two: a removal
+  // followed by an addition.
+  std::unordered_map<std::string, std::vector<size_t>> pending_event_indices_;
+  bool flush_scheduled_ = false;
+
+  mtl::MessageLoop* message_loop_;
   mtl::MessageLoop::HandlerKey handler_key_;
   ftl::WeakPtrFactory<DeviceWatcher> weak_ptr_factory_;
 
@@ -0,0 +1,191 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/io/device_watcher.h"
+
+#include <magenta/device/vfs.h>
+#include <mx/channel.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace mtl {
+
+// Feeds crafted watch messages to a |DeviceWatcher| through a channel which
+// stands in for the file system's.
+class DeviceWatcherTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<DeviceWatcher> CreateWatcher(
+      DeviceWatcher::Callback callback) {
+    auto watcher = CreateWatcherInternal();
+    watcher->callback_ = std::move(callback);
+    return watcher;
+  }
+
+  std::unique_ptr<DeviceWatcher> CreateBatchedWatcher(
+      DeviceWatcher::BatchCallback callback) {
+    auto watcher = CreateWatcherInternal();
+    watcher->batch_callback_ = std::move(callback);
+    return watcher;
+  }
+
+  std::unique_ptr<DeviceWatcher> CreateEventWatcher(
+      DeviceWatcher::EventOptions options,
+      DeviceWatcher::EventCallback callback) {
+    auto watcher = CreateWatcherInternal();
+    watcher->event_callback_ = std::move(callback);
+    watcher->debounce_ = options.debounce;
+    return watcher;
+  }
+
+  // Returns a watch message entry.
+  static std::string Entry(uint8_t event, const std::string& name) {
+    std::string entry;
+    entry.push_back(static_cast<char>(event));
+    entry.push_back(static_cast<char>(name.size()));
+    return entry + name;
+  }
+
+  void Send(const std::string& message) {
+    EXPECT_EQ(MX_OK, sender_.write(0u, message.data(), message.size(),
+                                   nullptr, 0u));
+  }
+
+  MessageLoop message_loop_;
+
+ private:
+  std::unique_ptr<DeviceWatcher> CreateWatcherInternal() {
+    mx::channel receiver;
+    EXPECT_EQ(MX_OK, mx::channel::create(0u, &sender_, &receiver));
+    return std::unique_ptr<DeviceWatcher>(new DeviceWatcher(
+        ftl::UniqueFD(), std::move(receiver), &message_loop_));
+  }
+
+  mx::channel sender_;
+};
+
+namespace {
+
+// Returns an entry whose name is cut short, which must be ignored.
+std::string TruncatedEntry() {
+  return std::string("\x01\x05"
+                     "cc",
+                     4u);
+}
+
+TEST_F(DeviceWatcherTest, Callback) {
+  std::vector<std::string> names;
+  auto watcher = CreateWatcher([&names](int dir_fd, std::string filename) {
+    names.push_back(std::move(filename));
+  });
+
+  Send(Entry(VFS_WATCH_EVT_EXISTING, "a") + Entry(VFS_WATCH_EVT_ADDED, "bb") +
+       Entry(VFS_WATCH_EVT_REMOVED, "ignored") + TruncatedEntry());
+  // A lone event byte is not an entry.
+  Send(Entry(VFS_WATCH_EVT_ADDED, "d") + std::string(1u, '\x01'));
+  message_loop_.RunUntilIdle();
+
+  EXPECT_EQ((std::vector<std::string>{"a", "bb", "d"}), names);
+}
+
+TEST_F(DeviceWatcherTest, BatchCallback) {
+  std::vector<std::vector<std::string>> batches;
+  auto watcher = CreateBatchedWatcher(
+      [&batches](int dir_fd, const std::vector<ftl::StringView>& filenames) {
+        std::vector<std::string> batch;
+        for (const auto& filename : filenames)
+          batch.push_back(filename.ToString());
+        batches.push_back(std::move(batch));
+      });
+
+  Send(Entry(VFS_WATCH_EVT_EXISTING, "a") + Entry(VFS_WATCH_EVT_ADDED, "bb") +
+       Entry(VFS_WATCH_EVT_REMOVED, "ignored") + TruncatedEntry());
+  Send(TruncatedEntry());
+  Send(Entry(VFS_WATCH_EVT_ADDED, "d"));
+  message_loop_.RunUntilIdle();
+
+  // One batch per message which names a device.
+  ASSERT_EQ(2u, batches.size());
+  EXPECT_EQ((std::vector<std::string>{"a", "bb"}), batches[0]);
+  EXPECT_EQ((std::vector<std::string>{"d"}), batches[1]);
+}
+
+TEST_F(DeviceWatcherTest, CallbackDestroysWatcher) {
+  std::vector<std::string> names;
+  std::unique_ptr<DeviceWatcher> watcher;
+  watcher = CreateWatcher([&names, &watcher](int dir_fd, std::string filename) {
+    names.push_back(std::move(filename));
+    watcher.reset();
+  });
+
+  Send(Entry(VFS_WATCH_EVT_ADDED, "a") + Entry(VFS_WATCH_EVT_ADDED, "b"));
+  Send(Entry(VFS_WATCH_EVT_ADDED, "c"));
+  message_loop_.RunUntilIdle();
+
+  EXPECT_EQ((std::vector<std::string>{"a"}), names);
+}
+
+using Event = DeviceWatcher::Event;
+
+std::vector<std::string> Describe(const std::vector<Event>& events) {
+  std::vector<std::string> result;
+  for (const Event& event : events) {
+    result.push_back((event.type == Event::Type::kAdded ? "+" : "-") +
+                     event.filename);
+  }
+  return result;
+}
+
+TEST_F(DeviceWatcherTest, EventsCoalesceWithinMessage) {
+  std::vector<std::vector<std::string>> batches;
+  auto watcher = CreateEventWatcher(
+      DeviceWatcher::EventOptions(),
+      [&batches](int dir_fd, const std::vector<Event>& events) {
+        batches.push_back(Describe(events));
+      });
+
+  // An addition and removal cancel out. A removal and addition are both
+  // kept. Repeats are reported once.
+  Send(Entry(VFS_WATCH_EVT_ADDED, "gone") +
+       Entry(VFS_WATCH_EVT_REMOVED, "replaced") +
+       Entry(VFS_WATCH_EVT_REMOVED, "gone") +
+       Entry(VFS_WATCH_EVT_ADDED, "replaced") +
+       Entry(VFS_WATCH_EVT_EXISTING, "new") +
+       Entry(VFS_WATCH_EVT_ADDED, "new") + TruncatedEntry());
+  // Removing the replacement leaves only the original removal.
+  Send(Entry(VFS_WATCH_EVT_REMOVED, "a") + Entry(VFS_WATCH_EVT_ADDED, "a") +
+       Entry(VFS_WATCH_EVT_REMOVED, "a"));
+  // Nothing is left to report.
+  Send(Entry(VFS_WATCH_EVT_ADDED, "b") + Entry(VFS_WATCH_EVT_REMOVED, "b"));
+  message_loop_.RunUntilIdle();
+
+  ASSERT_EQ(2u, batches.size());
+  EXPECT_EQ((std::vector<std::string>{"-replaced", "+replaced", "+new"}),
+            batches[0]);
+  EXPECT_EQ((std::vector<std::string>{"-a"}), batches[1]);
+}
+
+TEST_F(DeviceWatcherTest, EventsCoalesceAcrossDebouncedMessages) {
+  std::vector<std::vector<std::string>> batches;
+  DeviceWatcher::EventOptions options;
+  options.debounce = ftl::TimeDelta::FromMilliseconds(10);
+  auto watcher = CreateEventWatcher(
+      options, [this, &batches](int dir_fd, const std::vector<Event>& events) {
+        batches.push_back(Describe(events));
+        message_loop_.QuitNow();
+      });
+
+  Send(Entry(VFS_WATCH_EVT_ADDED, "a") + Entry(VFS_WATCH_EVT_ADDED, "b"));
+  Send(Entry(VFS_WATCH_EVT_REMOVED, "a"));
+  message_loop_.Run();
+
+  ASSERT_EQ(1u, batches.size());
+  EXPECT_EQ((std::vector<std::string>{"+b"}), batches[0]);
+}
+
+}  // namespace
+}  // namespace mtl
@@ -15,6 +15,7 @@
 #include "lib/fidl/c/waiter/async_waiter.h"
 #include "lib/fidl/cpp/waiter/default.h"
 #include "lib/ftl/files/file_descriptor.h"
+#include "lib/mtl/tracing/trace_event.h"
 
 namespace mtl {
 namespace {
@@ -44,6 +45,7 @@ class CopyToFileHandler {
   std::function<void(bool, ftl::UniqueFD)> callback_;
   const FidlAsyncWaiter* waiter_;
   FidlAsyncWaitID wait_id_;
+  uint64_t bytes_copied_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(CopyToFileHandler);
 };
@@ -58,7 +60,8 @@ CopyToFileHandler::CopyToFileHandler(
       task_runner_(std::move(task_runner)),
       callback_(callback),
       waiter_(fidl::GetDefaultAsyncWaiter()),
-      wait_id_(0) {
+      wait_id_(0),
+      bytes_copied_(0u) {
   task_runner_->PostTask([this]() { OnHandleReady(MX_OK); });
 }
 
@@ -73,6 +76,7 @@ void CopyToFileHandler::SendCallback(bool value) {
 }
 
 void CopyToFileHandler::OnHandleReady(mx_status_t result) {
+  MTL_TRACE_DURATION("mtl", "CopyToFileHandler::OnHandleReady");
   if (result == MX_OK) {
     std::vector<char> buffer(64 * 1024);
     size_t size = 0;
@@ -83,6 +87,8 @@ void CopyToFileHandler::OnHandleReady(mx_status_t result) {
       if (!write_success) {
         SendCallback(false);
       } else {
+        bytes_copied_ += size;
+        MTL_TRACE_COUNTER("mtl", "CopyToFileDescriptor bytes", bytes_copied_);
         task_runner_->PostTask([this]() { OnHandleReady(MX_OK); });
       }
       return;
@@ -139,6 +145,7 @@ class CopyFromFileHandler {
   size_t buffer_offset_;
   size_t buffer_end_;
   FidlAsyncWaitID wait_id_;
+  uint64_t bytes_copied_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(CopyFromFileHandler);
 };
@@ -154,7 +161,8 @@ CopyFromFileHandler::CopyFromFileHandler(
       callback_(callback),
       waiter_(fidl::GetDefaultAsyncWaiter()),
       buffer_(64 * 1024),
-      wait_id_(0) {
+      wait_id_(0),
+      bytes_copied_(0u) {
   task_runner_->PostTask([this]() { FillBuffer(); });
 }
 
@@ -169,6 +177,7 @@ void CopyFromFileHandler::SendCallback(bool value) {
 }
 
 void CopyFromFileHandler::FillBuffer() {
+  MTL_TRACE_DURATION("mtl", "CopyFromFileHandler::FillBuffer");
   ssize_t bytes_read =
       ftl::ReadFileDescriptor(source_.get(), buffer_.data(), buffer_.size());
   if (bytes_read <= 0) {
@@ -181,12 +190,15 @@ void CopyFromFileHandler::FillBuffer() {
 }
 
 void CopyFromFileHandler::OnHandleReady(mx_status_t result) {
+  MTL_TRACE_DURATION("mtl", "CopyFromFileHandler::OnHandleReady");
   if (result == MX_OK) {
     size_t bytes_written = 0;
     result = destination_.write(0u, buffer_.data() + buffer_offset_,
                                 buffer_end_ - buffer_offset_, &bytes_written);
     if (result == MX_OK) {
       buffer_offset_ += bytes_written;
+      bytes_copied_ += bytes_written;
+      MTL_TRACE_COUNTER("mtl", "CopyFromFileDescriptor bytes", bytes_copied_);
       if (buffer_offset_ == buffer_end_) {
         task_runner_->PostTask([this]() { FillBuffer(); });
       } else {
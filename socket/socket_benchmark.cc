@@ -0,0 +1,108 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fcntl.h>
+#include <mx/socket.h>
+
+#include <string>
+#include <thread>
+
+#include "lib/ftl/files/scoped_temp_dir.h"
+#include "lib/mtl/socket/files.h"
+#include "lib/mtl/socket/socket_drainer.h"
+#include "lib/mtl/socket/strings.h"
+#include "lib/mtl/tasks/message_loop.h"
+#include "lib/mtl/test/benchmark.h"
+
+namespace mtl {
+namespace {
+
+using benchmark::State;
+
+constexpr int64_t kKilobyte = 1024;
+constexpr int64_t kMegabyte = 1024 * kKilobyte;
+
+class CountingClient : public SocketDrainer::Client {
+ public:
+  explicit CountingClient(MessageLoop* loop) : loop_(loop) {}
+  ~CountingClient() override {}
+
+  size_t bytes() const { return bytes_; }
+
+ private:
+  void OnDataAvailable(const void* data, size_t num_bytes) override {
+    bytes_ += num_bytes;
+  }
+  void OnDataComplete() override { loop_->QuitNow(); }
+
+  MessageLoop* const loop_;
+  size_t bytes_ = 0u;
+};
+
+// Starts a thread which writes |data| to a new socket then closes it.
+// Returns the read end of the socket.
+mx::socket StartWriter(const std::string& data, std::thread* thread) {
+  mx::socket reader, writer;
+  mx::socket::create(0u, &reader, &writer);
+  *thread = std::thread([&data, writer = std::move(writer)]() mutable {
+    BlockingCopyFromString(data, writer);
+    writer.reset();
+  });
+  return reader;
+}
+
+void SocketDrainerBandwidth(State* state) {
+  MessageLoop loop;
+  const std::string data(state->range(), 'x');
+  while (state->KeepRunning()) {
+    CountingClient client(&loop);
+    SocketDrainer drainer(&client);
+    std::thread writer;
+    drainer.Start(StartWriter(data, &writer));
+    loop.Run();
+    writer.join();
+    if (client.bytes() != data.size()) {
+      state->SkipWithError("Short read");
+      break;
+    }
+  }
+  state->SetBytesProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(SocketDrainerBandwidth, 64 * kKilobyte, 4 * kMegabyte);
+
+void CopyToFileDescriptorBandwidth(State* state) {
+  files::ScopedTempDir temp_dir;
+  std::string path;
+  if (!temp_dir.NewTempFile(&path)) {
+    state->SkipWithError("Failed to create temp file");
+    return;
+  }
+
+  MessageLoop loop;
+  const std::string data(state->range(), 'x');
+  while (state->KeepRunning()) {
+    ftl::UniqueFD destination(open(path.c_str(), O_WRONLY | O_TRUNC));
+    std::thread writer;
+    bool success = false;
+    CopyToFileDescriptor(StartWriter(data, &writer), std::move(destination),
+                         loop.task_runner(),
+                         [&loop, &success](bool result, ftl::UniqueFD fd) {
+                           success = result;
+                           loop.QuitNow();
+                         });
+    loop.Run();
+    writer.join();
+    if (!success) {
+      state->SkipWithError("CopyToFileDescriptor failed");
+      break;
+    }
+  }
+  state->SetBytesProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(CopyToFileDescriptorBandwidth,
+                     64 * kKilobyte,
+                     4 * kMegabyte);
+
+}  // namespace
+}  // namespace mtl
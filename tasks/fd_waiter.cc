@@ -8,7 +8,13 @@
 
 namespace mtl {
 
-FDWaiter::FDWaiter() : io_(nullptr), key_(0) {}
+FDWaiter::FDWaiter() : FDWaiter(nullptr) {}
+
+FDWaiter::FDWaiter(MessageLoop* message_loop)
+    : message_loop_(message_loop),
+      wait_loop_(nullptr),
+      io_(nullptr),
+      key_(0) {}
 
 FDWaiter::~FDWaiter() {
   if (io_)
@@ -38,7 +44,9 @@ bool FDWaiter::Wait(Callback callback,
     return false;
   }
 
-  key_ = MessageLoop::GetCurrent()->AddHandler(this, handle, signals, timeout);
+  wait_loop_ = message_loop_ ? message_loop_ : MessageLoop::GetCurrent();
+  FTL_DCHECK(wait_loop_ == MessageLoop::GetCurrent());
+  key_ = wait_loop_->AddHandler(this, handle, signals, timeout);
 
   // Last to prevent re-entrancy from the move constructor of the callback.
   callback_ = std::move(callback);
@@ -49,11 +57,12 @@ void FDWaiter::Cancel() {
   FTL_DCHECK(io_);
 
   if (key_)
-    MessageLoop::GetCurrent()->RemoveHandler(key_);
+    wait_loop_->RemoveHandler(key_);
 
   __mxio_release(io_);
   io_ = nullptr;
   key_ = 0;
+  wait_loop_ = nullptr;
 
   // Last to prevent re-entrancy from the destructor of the callback.
   callback_ = Callback();
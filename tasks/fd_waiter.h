@@ -18,7 +18,12 @@ namespace mtl {
 
 class FTL_EXPORT FDWaiter : public MessageLoopHandler {
  public:
+  // Waits on the message loop of the thread which calls |Wait|.
   FDWaiter();
+
+  // Waits on |message_loop|, which must belong to the thread which calls
+  // |Wait| and outlive any outstanding wait.
+  explicit FDWaiter(MessageLoop* message_loop);
   ~FDWaiter() override;
 
   // If the wait was successful, the first argument will be MX_OK and the
@@ -60,6 +65,9 @@ class FTL_EXPORT FDWaiter : public MessageLoopHandler {
                      uint64_t count) override;
   void OnHandleError(mx_handle_t handle, mx_status_t error) override;
 
+  MessageLoop* const message_loop_;
+  // The loop of the outstanding wait.
+  MessageLoop* wait_loop_;
   mxio_t* io_;
   MessageLoop::HandlerKey key_;
   Callback callback_;
@@ -4,6 +4,7 @@
 
 #include <fcntl.h>
 #include <poll.h>
+#include <unistd.h>
 
 #include "gtest/gtest.h"
 #include "lib/mtl/tasks/fd_waiter.h"
@@ -35,5 +36,28 @@ TEST(FDWaiter, WaitFailed) {
       waiter.Wait([](mx_status_t status, uint32_t events) {}, -1, POLLOUT));
 }
 
+TEST(FDWaiter, ExplicitLoop) {
+  MessageLoop message_loop;
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+
+  bool called = false;
+  FDWaiter waiter(&message_loop);
+  EXPECT_TRUE(waiter.Wait(
+      [&](mx_status_t status, uint32_t events) {
+        EXPECT_EQ(MX_OK, status);
+        EXPECT_TRUE(events & POLLIN);
+        called = true;
+        message_loop.QuitNow();
+      },
+      fds[0], POLLIN));
+  EXPECT_EQ(1, write(fds[1], "x", 1));
+
+  message_loop.Run();
+  EXPECT_TRUE(called);
+  close(fds[0]);
+  close(fds[1]);
+}
+
 }  // namespace
 }  // namespace mtl
@@ -8,23 +8,36 @@
 #include <utility>
 
 #include "lib/ftl/logging.h"
+#include "lib/mtl/tracing/trace_event.h"
 
 namespace mtl {
 namespace {
 
+#if defined(MTL_INITIAL_EXEC_TLS) && MTL_INITIAL_EXEC_TLS
+// Builds which link libmtl into the executable can use the initial-exec model,
+// so accesses compile to a fixed offset from the thread pointer instead of a
+// call to |__tls_get_addr|. It is unsafe in a shared library that might be
+// dlopen()ed, hence the |mtl_initial_exec_tls| build argument.
+thread_local MessageLoop* g_current __attribute__((tls_model("initial-exec")));
+#else
 thread_local MessageLoop* g_current;
+#endif
 
 }  // namespace
 
 class MessageLoop::TaskRecord : public async::Task {
  public:
-  TaskRecord(mx_time_t deadline, ftl::Closure task);
+  TaskRecord(mx_time_t deadline, MessageLoop* loop, ftl::Closure task);
   ~TaskRecord() override;
 
   async_task_result_t Handle(async_t* async, mx_status_t status) override;
 
  private:
+  MessageLoop* loop_;
   ftl::Closure task_;
+#if defined(MTL_TRACE_EVENTS_ENABLED) && MTL_TRACE_EVENTS_ENABLED
+  uint64_t flow_id_;
+#endif
 };
 
 class MessageLoop::HandlerRecord : public async::WaitWithTimeout {
@@ -41,10 +54,19 @@ class MessageLoop::HandlerRecord : public async::WaitWithTimeout {
                              mx_status_t status,
                              const mx_packet_signal_t* signal) override;
 
+  // Whether the handler is being called. It may run a nested loop, so any
+  // number of records can be running at once.
+  bool running() const { return running_; }
+
+  // Marks a running record for destruction once its handler returns.
+  void set_removed() { removed_ = true; }
+
  private:
   MessageLoop* loop_;
   MessageLoopHandler* handler_;
   HandlerKey key_;
+  bool running_ = false;
+  bool removed_ = false;
 };
 
 MessageLoop::MessageLoop()
@@ -82,11 +104,15 @@ MessageLoop* MessageLoop::GetCurrent() {
 void MessageLoop::PostTask(ftl::Closure task, ftl::TimePoint target_time) {
   // TODO(jeffbrown): Consider allocating tasks from a pool.
   auto record = new TaskRecord(target_time.ToEpochDelta().ToNanoseconds(),
-                               std::move(task));
+                               this, std::move(task));
 
+  // Counted before posting since the task may run on the loop's thread
+  // before |Post| returns.
+  pending_task_count_.fetch_add(1u, std::memory_order_relaxed);
   mx_status_t status = record->Post(loop_.async());
   if (status == MX_ERR_BAD_STATE) {
     // Suppress request when shutting down.
+    pending_task_count_.fetch_sub(1u, std::memory_order_relaxed);
     delete record;
     return;
   }
@@ -134,8 +160,8 @@ void MessageLoop::RemoveHandler(HandlerKey key) {
   HandlerRecord* record = it->second;
   handlers_.erase(it);
 
-  if (current_handler_ == record) {
-    current_handler_removed_ = true;  // defer cleanup
+  if (record->running()) {
+    record->set_removed();  // defer cleanup
   } else {
     mx_status_t status = record->Cancel(loop_.async());
     if (status == MX_ERR_BAD_HANDLE) {
@@ -158,30 +184,58 @@ bool MessageLoop::HasHandler(HandlerKey key) const {
 }
 
 void MessageLoop::Run() {
+  RunInternal(MX_TIME_INFINITE, false);
+}
+
+bool MessageLoop::RunUntilIdle() {
+  return RunInternal(MX_TIME_INFINITE, true) == MX_OK;
+}
+
+void MessageLoop::RunFor(ftl::TimeDelta duration) {
+  RunInternal(mx_deadline_after(duration.ToNanoseconds()), false);
+}
+
+void MessageLoop::SetNestedRunsAllowed(bool allowed) {
   FTL_DCHECK(g_current == this);
 
-  FTL_CHECK(!is_running_) << "Cannot run a nested message loop.";
-  is_running_ = true;
+  nested_runs_allowed_ = allowed;
+}
 
-  mx_status_t status = loop_.Run();
-  FTL_CHECK(status == MX_OK || status == MX_ERR_CANCELED)
-      << "Loop stopped abnormally: status=" << status;
+mx_status_t MessageLoop::RunInternal(mx_time_t deadline, bool until_idle) {
+  FTL_DCHECK(g_current == this);
+
+  FTL_CHECK(run_depth_ == 0 || nested_runs_allowed_)
+      << "Cannot run a nested message loop.";
+  run_depth_++;
+
+  mx_status_t result =
+      until_idle ? loop_.RunUntilIdle() : loop_.Run(deadline);
+  FTL_CHECK(result == MX_OK || result == MX_ERR_CANCELED ||
+            result == MX_ERR_TIMED_OUT)
+      << "Loop stopped abnormally: status=" << result;
 
-  status = loop_.ResetQuit();
+  // The quit state is shared by all runs; clear it so that an enclosing run
+  // keeps going.
+  mx_status_t status = loop_.ResetQuit();
   FTL_DCHECK(status == MX_OK)
       << "Failed to reset quit state: status=" << status;
 
-  FTL_DCHECK(is_running_);
-  is_running_ = false;
+  FTL_DCHECK(run_depth_ > 0);
+  run_depth_--;
+  return result;
 }
 
 void MessageLoop::QuitNow() {
   FTL_DCHECK(g_current == this);
 
-  if (is_running_)
+  if (run_depth_)
     loop_.Quit();
 }
 
+void MessageLoop::QuitFromAnyThread() {
+  loop_.Quit();
+}
+
 void MessageLoop::PostQuitTask() {
   task_runner()->PostTask([this]() { QuitNow(); });
 }
@@ -208,15 +262,29 @@ void MessageLoop::Epilogue(async_t* async, void* data) {
     loop->after_task_callback_();
 }
 
-MessageLoop::TaskRecord::TaskRecord(mx_time_t deadline, ftl::Closure task)
-    : async::Task(deadline, ASYNC_HANDLE_SHUTDOWN), task_(std::move(task)) {}
+MessageLoop::TaskRecord::TaskRecord(mx_time_t deadline,
+                                    MessageLoop* loop,
+                                    ftl::Closure task)
+    : async::Task(deadline, ASYNC_HANDLE_SHUTDOWN),
+      loop_(loop),
+      task_(std::move(task)) {
+#if defined(MTL_TRACE_EVENTS_ENABLED) && MTL_TRACE_EVENTS_ENABLED
+  // Records are created on the posting thread.
+  flow_id_ = MTL_TRACE_NEXT_FLOW_ID();
+  MTL_TRACE_FLOW_BEGIN("mtl", "MessageLoop::PostTask", flow_id_);
+#endif
+}
 
 MessageLoop::TaskRecord::~TaskRecord() {}
 
 async_task_result_t MessageLoop::TaskRecord::Handle(async_t* async,
                                                     mx_status_t status) {
-  if (status == MX_OK)
+  loop_->pending_task_count_.fetch_sub(1u, std::memory_order_relaxed);
+  if (status == MX_OK) {
+    MTL_TRACE_DURATION("mtl", "MessageLoop::RunTask");
+    MTL_TRACE_FLOW_END("mtl", "MessageLoop::PostTask", flow_id_);
     task_();
+  }
   delete this;
   return ASYNC_TASK_FINISHED;
 }
@@ -238,28 +306,28 @@ async_wait_result_t MessageLoop::HandlerRecord::Handle(
     async_t* async,
     mx_status_t status,
     const mx_packet_signal_t* signal) {
-  FTL_DCHECK(!loop_->current_handler_);
-  loop_->current_handler_ = this;
+  // The wait is not re-armed until this returns, so it cannot be re-entered.
+  FTL_DCHECK(!running_);
+  running_ = true;
 
   if (status == MX_OK) {
+    MTL_TRACE_DURATION("mtl", "MessageLoopHandler::OnHandleReady");
     handler_->OnHandleReady(object(), signal->observed, signal->count);
   } else {
     handler_->OnHandleError(object(), status);
 
-    if (!loop_->current_handler_removed_) {
+    if (!removed_) {
       auto it = loop_->handlers_.find(key_);
       FTL_DCHECK(it != loop_->handlers_.end());
       loop_->handlers_.erase(it);
-      loop_->current_handler_removed_ = true;
+      removed_ = true;
     }
   }
 
-  FTL_DCHECK(loop_->current_handler_ == this);
-  loop_->current_handler_ = nullptr;
-  if (!loop_->current_handler_removed_)
+  running_ = false;
+  if (!removed_)
     return ASYNC_WAIT_AGAIN;
 
-  loop_->current_handler_removed_ = false;
   delete this;
   return ASYNC_WAIT_FINISHED;
 }
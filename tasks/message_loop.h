@@ -5,6 +5,7 @@
 #ifndef LIB_MTL_TASKS_MESSAGE_LOOP_H_
 #define LIB_MTL_TASKS_MESSAGE_LOOP_H_
 
+#include <atomic>
 #include <map>
 
 #include <async/loop.h>
@@ -35,6 +36,9 @@ class FTL_EXPORT MessageLoop : private internal::TaskQueueDelegate {
   ~MessageLoop() override;
 
   // Returns the message loop associated with the current thread, if any.
+  //
+  // Helpers which register handlers, such as |FDWaiter| and |VFSDispatcher|,
+  // also accept the loop explicitly so that hot paths need not look it up.
   static MessageLoop* GetCurrent();
 
   // Gets the underlying libasync dispatcher.
@@ -82,10 +86,40 @@ class FTL_EXPORT MessageLoop : private internal::TaskQueueDelegate {
   // via the |task_runner|.
   void Run();
 
-  // Prevents further tasks from running and returns from |Run|. Must be called
-  // while |Run| is on the stack.
+  // Runs tasks and handlers which are ready now, without blocking, and returns
+  // once there is nothing left to do or |QuitNow| is called. Useful for
+  // pumping the loop deterministically in tests.
+  //
+  // Returns true if the loop became idle, false if it was quit first.
+  bool RunUntilIdle();
+
+  // Like |Run| but also returns once |duration| has elapsed.
+  void RunFor(ftl::TimeDelta duration);
+
+  // Allows |Run|, |RunUntilIdle| and |RunFor| to be called from within a task
+  // or handler running on this loop. Nested runs are disallowed by default
+  // since code which is not expecting to be re-entered may break.
+  //
+  // |QuitNow| only returns from the innermost run.
+  void SetNestedRunsAllowed(bool allowed);
+  bool nested_runs_allowed() const { return nested_runs_allowed_; }
+
+  // Prevents further tasks from running and returns from the innermost |Run|,
+  // |RunUntilIdle| or |RunFor|. Must be called while one of them is on the
+  // stack.
   void QuitNow();
 
+  // Like |QuitNow| but may be called from any thread. If no run is in
+  // progress, the next one returns immediately.
+  void QuitFromAnyThread();
+
+  // Returns the number of tasks which have been posted to the loop but have
+  // not run yet, including delayed tasks which are not due. These are dropped
+  // if the loop is destroyed. May be called from any thread.
+  size_t pending_task_count() const {
+    return pending_task_count_.load(std::memory_order_relaxed);
+  }
+
   // Posts a task to the queue that calls |QuitNow|. Useful for gracefully
   // ending the message loop. Can be called whether or not |Run| is on the
   // stack.
@@ -96,6 +130,8 @@ class FTL_EXPORT MessageLoop : private internal::TaskQueueDelegate {
   void PostTask(ftl::Closure task, ftl::TimePoint target_time) override;
   bool RunsTasksOnCurrentThread() override;
 
+  mx_status_t RunInternal(mx_time_t deadline, bool until_idle);
+
   static void Epilogue(async_t* async, void* data);
 
   internal::IncomingTaskQueue* incoming_tasks() {
@@ -110,17 +146,13 @@ class FTL_EXPORT MessageLoop : private internal::TaskQueueDelegate {
 
   ftl::RefPtr<ftl::TaskRunner> task_runner_;
   ftl::Closure after_task_callback_;
-  bool is_running_ = false;
+  std::atomic<size_t> pending_task_count_{0u};
+  int run_depth_ = 0;
+  bool nested_runs_allowed_ = false;
 
   HandlerKey next_handler_key_ = 1u;
   std::map<HandlerKey, HandlerRecord*> handlers_;
 
-  // Set while the handler is running.
-  HandlerRecord* current_handler_ = nullptr;
-
-  // Set to true if the current handler needs to be destroyed once it returns.
-  bool current_handler_removed_ = false;
-
   FTL_DISALLOW_COPY_AND_ASSIGN(MessageLoop);
 };
 
@@ -0,0 +1,175 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/tasks/message_loop.h"
+
+#include <mx/event.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "lib/ftl/files/unique_fd.h"
+#include "lib/mtl/tasks/fd_waiter.h"
+#include "lib/mtl/test/benchmark.h"
+
+namespace mtl {
+namespace {
+
+using benchmark::State;
+
+// Posts |range| tasks then runs the loop until all of them have executed.
+void PostAndDispatchTasks(State* state) {
+  MessageLoop loop;
+  const int64_t task_count = state->range();
+  int64_t tasks_run = 0;
+  while (state->KeepRunning()) {
+    for (int64_t i = 0; i < task_count; i++)
+      loop.task_runner()->PostTask([&tasks_run] { tasks_run++; });
+    loop.PostQuitTask();
+    loop.Run();
+  }
+  if (tasks_run != task_count * static_cast<int64_t>(state->iterations()))
+    state->SkipWithError("Not all tasks ran");
+  state->SetItemsProcessed(tasks_run);
+}
+MTL_BENCHMARK_RANGES(PostAndDispatchTasks, 1, 64, 1024);
+
+// Each task posts the next one, so the loop never sees more than one task.
+void ChainedTasks(State* state) {
+  MessageLoop loop;
+  int64_t remaining = 0;
+  std::function<void()> task;
+  task = [&loop, &remaining, &task] {
+    if (--remaining > 0)
+      loop.task_runner()->PostTask(task);
+    else
+      loop.QuitNow();
+  };
+  while (state->KeepRunning()) {
+    remaining = state->range();
+    loop.task_runner()->PostTask(task);
+    loop.Run();
+  }
+  state->SetItemsProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(ChainedTasks, 1024);
+
+class NoopHandler : public MessageLoopHandler {};
+
+void AddRemoveHandler(State* state) {
+  MessageLoop loop;
+  mx::event event;
+  if (mx::event::create(0u, &event) != MX_OK) {
+    state->SkipWithError("Failed to create event");
+    return;
+  }
+  NoopHandler handler;
+  while (state->KeepRunning()) {
+    MessageLoop::HandlerKey key =
+        loop.AddHandler(&handler, event.get(), MX_EVENT_SIGNALED);
+    loop.RemoveHandler(key);
+  }
+  state->SetItemsProcessed(state->iterations());
+}
+MTL_BENCHMARK(AddRemoveHandler);
+
+// Like |AddRemoveHandler| but every handler is also registered with the
+// timer queue.
+void AddRemoveHandlerWithTimeout(State* state) {
+  MessageLoop loop;
+  mx::event event;
+  if (mx::event::create(0u, &event) != MX_OK) {
+    state->SkipWithError("Failed to create event");
+    return;
+  }
+  NoopHandler handler;
+  while (state->KeepRunning()) {
+    MessageLoop::HandlerKey key =
+        loop.AddHandler(&handler, event.get(), MX_EVENT_SIGNALED,
+                        ftl::TimeDelta::FromSeconds(60));
+    loop.RemoveHandler(key);
+  }
+  state->SetItemsProcessed(state->iterations());
+}
+MTL_BENCHMARK(AddRemoveHandlerWithTimeout);
+
+// Measures the cost of inserting |range| delayed tasks into the timer queue.
+// The tasks are due far in the future and are dropped with the loop.
+void ScheduleDelayedTasks(State* state) {
+  const int64_t task_count = state->range();
+  while (state->KeepRunning()) {
+    state->PauseTiming();
+    {
+      MessageLoop loop;
+      state->ResumeTiming();
+      for (int64_t i = 0; i < task_count; i++) {
+        loop.task_runner()->PostDelayedTask(
+            [] {}, ftl::TimeDelta::FromSeconds(3600 + task_count - i));
+      }
+      state->PauseTiming();
+    }
+    state->ResumeTiming();
+  }
+  state->SetItemsProcessed(state->iterations() * task_count);
+}
+MTL_BENCHMARK_RANGES(ScheduleDelayedTasks, 16, 1024);
+
+// Measures dispatch of delayed tasks which are all already due.
+void DispatchExpiredDelayedTasks(State* state) {
+  MessageLoop loop;
+  const int64_t task_count = state->range();
+  while (state->KeepRunning()) {
+    ftl::TimePoint now = ftl::TimePoint::Now();
+    for (int64_t i = 0; i < task_count; i++)
+      loop.task_runner()->PostTaskForTime([] {}, now);
+    loop.task_runner()->PostTaskForTime([&loop] { loop.QuitNow(); }, now);
+    loop.Run();
+  }
+  state->SetItemsProcessed(state->iterations() * task_count);
+}
+MTL_BENCHMARK_RANGES(DispatchExpiredDelayedTasks, 1024);
+
+// The thread-local lookup which the explicit-loop helper variants avoid.
+void GetCurrent(State* state) {
+  MessageLoop loop;
+  MessageLoop* current = nullptr;
+  while (state->KeepRunning()) {
+    current = MessageLoop::GetCurrent();
+    // Keep the load from being hoisted out of the loop.
+    asm volatile("" : "+r"(current));
+  }
+  if (current != &loop)
+    state->SkipWithError("Wrong loop");
+  state->SetItemsProcessed(state->iterations());
+}
+MTL_BENCHMARK(GetCurrent);
+
+// Starts and cancels an |FDWaiter| wait. |range| selects whether the waiter
+// looks up the current loop (0) or is given it explicitly (1).
+void FDWaiterWaitCancel(State* state) {
+  MessageLoop loop;
+  int fds[2];
+  if (pipe(fds) != 0) {
+    state->SkipWithError("Failed to create pipe");
+    return;
+  }
+  ftl::UniqueFD read_end(fds[0]);
+  ftl::UniqueFD write_end(fds[1]);
+
+  FDWaiter implicit_waiter;
+  FDWaiter explicit_waiter(&loop);
+  FDWaiter& waiter = state->range() ? explicit_waiter : implicit_waiter;
+  while (state->KeepRunning()) {
+    if (!waiter.Wait([](mx_status_t status, uint32_t events) {},
+                     read_end.get(), POLLIN)) {
+      state->SkipWithError("Failed to wait");
+      break;
+    }
+    waiter.Cancel();
+  }
+  state->SetItemsProcessed(state->iterations());
+}
+MTL_BENCHMARK_RANGES(FDWaiterWaitCancel, 0, 1);
+
+}  // namespace
+}  // namespace mtl
@@ -179,8 +179,7 @@ TEST(MessageLoop, TaskDestructionTime) {
   {
     MessageLoop loop;
     task_runner = ftl::RefPtr<ftl::TaskRunner>(loop.task_runner());
-    loop.PostQuitTask();
-    loop.Run();
+    loop.RunUntilIdle();
     auto observer1 = std::make_unique<DestructorObserver>(
         [&destructed] { destructed = true; });
     task_runner->PostTask(ftl::MakeCopyable([p = std::move(observer1)](){}));
@@ -206,6 +205,26 @@ TEST(MessageLoop, CanQuitCurrent) {
   EXPECT_TRUE(did_run);
 }
 
+TEST(MessageLoop, QuitFromAnyThread) {
+  MessageLoop loop;
+  std::thread thread;
+  loop.task_runner()->PostTask([&loop, &thread] {
+    thread = std::thread([&loop] { loop.QuitFromAnyThread(); });
+  });
+  loop.Run();
+  thread.join();
+}
+
+TEST(MessageLoop, PendingTaskCount) {
+  MessageLoop loop;
+  EXPECT_EQ(0u, loop.pending_task_count());
+  loop.task_runner()->PostTask([] {});
+  loop.task_runner()->PostDelayedTask([] {}, ftl::TimeDelta::FromSeconds(60));
+  EXPECT_EQ(2u, loop.pending_task_count());
+  loop.RunUntilIdle();
+  EXPECT_EQ(1u, loop.pending_task_count());
+}
+
 TEST(MessageLoop, CanQuitManyTimes) {
   MessageLoop loop;
   loop.QuitNow();
@@ -216,6 +235,138 @@ TEST(MessageLoop, CanQuitManyTimes) {
   loop.QuitNow();
 }
 
+TEST(MessageLoop, RunUntilIdle) {
+  std::vector<std::string> tasks;
+  MessageLoop loop;
+  loop.task_runner()->PostTask([&tasks, &loop] {
+    tasks.push_back("0");
+    loop.task_runner()->PostTask([&tasks] { tasks.push_back("1"); });
+  });
+  loop.task_runner()->PostDelayedTask([&tasks] { tasks.push_back("2"); },
+                                      ftl::TimeDelta::FromSeconds(60));
+  EXPECT_TRUE(loop.RunUntilIdle());
+  EXPECT_EQ(2u, tasks.size());
+  EXPECT_EQ("0", tasks[0]);
+  EXPECT_EQ("1", tasks[1]);
+
+  // Returns immediately when there is nothing to do.
+  EXPECT_TRUE(loop.RunUntilIdle());
+  EXPECT_EQ(2u, tasks.size());
+}
+
+TEST(MessageLoop, RunUntilIdleCanQuit) {
+  std::vector<std::string> tasks;
+  MessageLoop loop;
+  loop.task_runner()->PostTask([&tasks] { tasks.push_back("0"); });
+  loop.PostQuitTask();
+  loop.task_runner()->PostTask([&tasks] { tasks.push_back("1"); });
+  EXPECT_FALSE(loop.RunUntilIdle());
+  EXPECT_EQ(1u, tasks.size());
+
+  EXPECT_TRUE(loop.RunUntilIdle());
+  EXPECT_EQ(2u, tasks.size());
+}
+
+TEST(MessageLoop, RunFor) {
+  bool did_run = false;
+  MessageLoop loop;
+  loop.task_runner()->PostDelayedTask([&did_run] { did_run = true; },
+                                      ftl::TimeDelta::FromMilliseconds(1));
+  ftl::TimePoint start = ftl::TimePoint::Now();
+  loop.RunFor(ftl::TimeDelta::FromMilliseconds(20));
+  EXPECT_TRUE(did_run);
+  EXPECT_GE(ftl::TimePoint::Now() - start,
+            ftl::TimeDelta::FromMilliseconds(20));
+}
+
+TEST(MessageLoop, RunForCanQuit) {
+  MessageLoop loop;
+  loop.PostQuitTask();
+  ftl::TimePoint start = ftl::TimePoint::Now();
+  loop.RunFor(ftl::TimeDelta::FromSeconds(60));
+  EXPECT_LT(ftl::TimePoint::Now() - start, ftl::TimeDelta::FromSeconds(60));
+}
+
+TEST(MessageLoop, NestedRunUntilIdle) {
+  std::vector<std::string> tasks;
+  MessageLoop loop;
+  loop.SetNestedRunsAllowed(true);
+  loop.task_runner()->PostTask([&tasks, &loop] {
+    tasks.push_back("outer");
+    loop.task_runner()->PostTask([&tasks] { tasks.push_back("inner"); });
+    loop.RunUntilIdle();
+    tasks.push_back("outer done");
+    loop.QuitNow();
+  });
+  loop.Run();
+  ASSERT_EQ(3u, tasks.size());
+  EXPECT_EQ("outer", tasks[0]);
+  EXPECT_EQ("inner", tasks[1]);
+  EXPECT_EQ("outer done", tasks[2]);
+}
+
+// Verifies that QuitNow() from a nested run only returns from that run.
+TEST(MessageLoop, NestedQuitOnlyExitsInnermostRun) {
+  std::vector<std::string> tasks;
+  MessageLoop loop;
+  loop.SetNestedRunsAllowed(true);
+  loop.task_runner()->PostTask([&tasks, &loop] {
+    loop.PostQuitTask();
+    loop.Run();
+    tasks.push_back("nested done");
+    loop.task_runner()->PostTask([&tasks, &loop] {
+      tasks.push_back("after nested");
+      loop.QuitNow();
+    });
+  });
+  loop.Run();
+  ASSERT_EQ(2u, tasks.size());
+  EXPECT_EQ("nested done", tasks[0]);
+  EXPECT_EQ("after nested", tasks[1]);
+}
+
+class CallbackHandler : public MessageLoopHandler {
+ public:
+  explicit CallbackHandler(std::function<void()> on_ready)
+      : on_ready_(std::move(on_ready)) {}
+  ~CallbackHandler() override {}
+
+  void OnHandleReady(mx_handle_t handle,
+                     mx_signals_t pending,
+                     uint64_t count) override {
+    on_ready_();
+  }
+
+ private:
+  std::function<void()> on_ready_;
+};
+
+// Verifies that a handler which is running a nested loop can be removed from
+// within that loop.
+TEST(MessageLoop, RemoveOuterHandlerFromNestedRun) {
+  MessageLoop loop;
+  loop.SetNestedRunsAllowed(true);
+  mx::event event;
+  ASSERT_EQ(MX_OK, mx::event::create(0u, &event));
+
+  MessageLoop::HandlerKey key = 0u;
+  int ready_count = 0;
+  CallbackHandler handler([&loop, &key, &ready_count] {
+    ready_count++;
+    loop.task_runner()->PostTask([&loop, &key] { loop.RemoveHandler(key); });
+    loop.RunUntilIdle();
+    EXPECT_FALSE(loop.HasHandler(key));
+    loop.PostQuitTask();
+  });
+  key = loop.AddHandler(&handler, event.get(), MX_EVENT_SIGNALED);
+  EXPECT_EQ(MX_OK, event.signal(0u, MX_EVENT_SIGNALED));
+  loop.Run();
+
+  // The event is still signaled but the handler is gone.
+  loop.RunUntilIdle();
+  EXPECT_EQ(1, ready_count);
+}
+
 class TestMessageLoopHandler : public MessageLoopHandler {
  public:
   TestMessageLoopHandler() {}
@@ -0,0 +1,63 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/tasks/task_runner_util.h"
+
+#include <memory>
+
+#include "lib/ftl/synchronization/waitable_event.h"
+
+namespace mtl {
+namespace {
+
+// Signals an event when destroyed, whether or not the closure which owns it
+// ever ran.
+class SignalOnDestruction {
+ public:
+  explicit SignalOnDestruction(ftl::AutoResetWaitableEvent* event)
+      : event_(event) {}
+  ~SignalOnDestruction() { event_->Signal(); }
+
+ private:
+  ftl::AutoResetWaitableEvent* const event_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(SignalOnDestruction);
+};
+
+}  // namespace
+
+void PostTaskAndReply(const ftl::RefPtr<ftl::TaskRunner>& task_runner,
+                      ftl::Closure task,
+                      ftl::Closure reply) {
+  MessageLoop* message_loop = MessageLoop::GetCurrent();
+  FTL_DCHECK(message_loop) << "PostTaskAndReply requires a MessageLoop";
+
+  ftl::RefPtr<ftl::TaskRunner> reply_runner = message_loop->task_runner();
+  task_runner->PostTask([
+    task = std::move(task), reply = std::move(reply),
+    reply_runner = std::move(reply_runner)
+  ]() mutable {
+    task();
+    reply_runner->PostTask(std::move(reply));
+  });
+}
+
+bool RunSync(const ftl::RefPtr<ftl::TaskRunner>& task_runner,
+             ftl::Closure task) {
+  FTL_DCHECK(!task_runner->RunsTasksOnCurrentThread())
+      << "RunSync would deadlock on the task runner's own thread";
+
+  bool ran = false;
+  ftl::AutoResetWaitableEvent done;
+  auto signal = std::make_shared<SignalOnDestruction>(&done);
+  task_runner->PostTask([&task, &ran, signal] {
+    task();
+    ran = true;
+  });
+  signal.reset();
+  done.Wait();
+  return ran;
+}
+
+}  // namespace mtl
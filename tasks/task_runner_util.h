@@ -0,0 +1,73 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_MTL_TASKS_TASK_RUNNER_UTIL_H_
+#define LIB_MTL_TASKS_TASK_RUNNER_UTIL_H_
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "lib/ftl/ftl_export.h"
+#include "lib/ftl/functional/closure.h"
+#include "lib/ftl/logging.h"
+#include "lib/ftl/tasks/task_runner.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace mtl {
+
+// Posts |task| to |task_runner|. Once it has run, posts |reply| back to the
+// message loop of the calling thread, which must have one.
+//
+// If either loop is destroyed first, the remaining closures are destroyed
+// without running on whichever thread drops them.
+FTL_EXPORT void PostTaskAndReply(
+    const ftl::RefPtr<ftl::TaskRunner>& task_runner,
+    ftl::Closure task,
+    ftl::Closure reply);
+
+// Like |PostTaskAndReply| but passes the value returned by |task| to |reply|.
+// The result type is deduced from |task|.
+//
+// |task| and |reply| are captured by value rather than wrapped in further
+// |std::function|s, and the result is moved straight into the reply closure,
+// so small results need no allocation of their own. The result must be
+// copy-constructible because closures are stored in |std::function|, but it
+// is only ever moved.
+template <typename Task, typename Reply>
+void PostTaskAndReplyWithResult(const ftl::RefPtr<ftl::TaskRunner>& task_runner,
+                                Task task,
+                                Reply reply) {
+  using Result =
+      typename std::decay<typename std::result_of<Task&()>::type>::type;
+
+  MessageLoop* message_loop = MessageLoop::GetCurrent();
+  FTL_DCHECK(message_loop)
+      << "PostTaskAndReplyWithResult requires a MessageLoop";
+
+  ftl::RefPtr<ftl::TaskRunner> reply_runner = message_loop->task_runner();
+  task_runner->PostTask([
+    task = std::move(task), reply = std::move(reply),
+    reply_runner = std::move(reply_runner)
+  ]() mutable {
+    Result result = task();
+    reply_runner->PostTask(
+        [ reply = std::move(reply), result = std::move(result) ]() mutable {
+          reply(std::move(result));
+        });
+  });
+}
+
+// Runs |task| on |task_runner| and blocks the calling thread until it has
+// completed. Returns false if the task was dropped without running, for
+// example because the target loop was shutting down.
+//
+// Intended for tests and shutdown paths. It is an error to call this on the
+// thread |task_runner| runs tasks on since that would deadlock.
+FTL_EXPORT bool RunSync(const ftl::RefPtr<ftl::TaskRunner>& task_runner,
+                        ftl::Closure task);
+
+}  // namespace mtl
+
+#endif  // LIB_MTL_TASKS_TASK_RUNNER_UTIL_H_
@@ -0,0 +1,85 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/tasks/task_runner_util.h"
+
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "lib/mtl/tasks/message_loop.h"
+#include "lib/mtl/threading/thread.h"
+
+namespace mtl {
+namespace {
+
+void QuitThread(Thread* thread) {
+  thread->TaskRunner()->PostTask(
+      [] { MessageLoop::GetCurrent()->QuitNow(); });
+  EXPECT_TRUE(thread->Join());
+}
+
+TEST(TaskRunnerUtil, PostTaskAndReply) {
+  MessageLoop loop;
+  Thread thread;
+  ASSERT_TRUE(thread.Run());
+
+  std::thread::id task_thread;
+  bool replied = false;
+  PostTaskAndReply(thread.TaskRunner(),
+                   [&task_thread] { task_thread = std::this_thread::get_id(); },
+                   [&loop, &replied] {
+                     EXPECT_EQ(&loop, MessageLoop::GetCurrent());
+                     replied = true;
+                     loop.QuitNow();
+                   });
+  loop.Run();
+
+  EXPECT_TRUE(replied);
+  EXPECT_NE(std::this_thread::get_id(), task_thread);
+  QuitThread(&thread);
+}
+
+TEST(TaskRunnerUtil, PostTaskAndReplyWithResult) {
+  MessageLoop loop;
+  Thread thread;
+  ASSERT_TRUE(thread.Run());
+
+  std::string result;
+  PostTaskAndReplyWithResult(
+      thread.TaskRunner(), [] { return std::string("hello"); },
+      [&loop, &result](std::string value) {
+        result = std::move(value);
+        loop.QuitNow();
+      });
+  loop.Run();
+
+  EXPECT_EQ("hello", result);
+  QuitThread(&thread);
+}
+
+TEST(TaskRunnerUtil, RunSync) {
+  Thread thread;
+  ASSERT_TRUE(thread.Run());
+
+  std::thread::id task_thread;
+  EXPECT_TRUE(RunSync(thread.TaskRunner(), [&task_thread] {
+    task_thread = std::this_thread::get_id();
+  }));
+  EXPECT_NE(std::this_thread::get_id(), task_thread);
+  QuitThread(&thread);
+}
+
+TEST(TaskRunnerUtil, RunSyncDroppedTask) {
+  Thread thread;
+  ASSERT_TRUE(thread.Run());
+  QuitThread(&thread);
+
+  bool ran = false;
+  EXPECT_FALSE(RunSync(thread.TaskRunner(), [&ran] { ran = true; }));
+  EXPECT_FALSE(ran);
+}
+
+}  // namespace
+}  // namespace mtl
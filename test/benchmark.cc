@@ -0,0 +1,223 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/test/benchmark.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <thread>
+#include <utility>
+
+#include "lib/ftl/command_line.h"
+#include "lib/ftl/files/file.h"
+#include "lib/ftl/logging.h"
+#include "lib/ftl/strings/string_number_conversions.h"
+
+namespace mtl {
+namespace benchmark {
+namespace {
+
+constexpr uint64_t kMaxIterations = 1000000000u;
+
+struct Benchmark {
+  std::string name;
+  Function function;
+  std::vector<int64_t> ranges;
+};
+
+std::vector<Benchmark>* GetBenchmarks() {
+  static std::vector<Benchmark>* benchmarks = new std::vector<Benchmark>();
+  return benchmarks;
+}
+
+struct Result {
+  std::string name;
+  uint64_t iterations = 0u;
+  ftl::TimeDelta elapsed;
+  int64_t bytes_processed = 0;
+  int64_t items_processed = 0;
+  std::string error_message;
+};
+
+Result Run(const std::string& name,
+           Function function,
+           int64_t range,
+           ftl::TimeDelta min_time) {
+  Result result;
+  result.name = name;
+
+  // Grow the iteration count geometrically until a run is long enough to
+  // give a stable measurement, similar to Google Benchmark.
+  uint64_t iterations = 1u;
+  for (;;) {
+    State state(range, iterations);
+    function(&state);
+
+    result.iterations = iterations;
+    result.elapsed = state.elapsed();
+    result.bytes_processed = state.bytes_processed();
+    result.items_processed = state.items_processed();
+    result.error_message = state.error_message();
+    if (state.error_occurred() || state.elapsed() >= min_time ||
+        iterations >= kMaxIterations)
+      return result;
+
+    // Aim 40% past the minimum time, but grow at most tenfold per step.
+    double multiplier = 10.0;
+    if (state.elapsed() > ftl::TimeDelta::Zero()) {
+      multiplier = 1.4 * min_time.ToSecondsF() / state.elapsed().ToSecondsF();
+      if (multiplier > 10.0)
+        multiplier = 10.0;
+    }
+    uint64_t next = static_cast<uint64_t>(iterations * multiplier);
+    iterations = next > iterations ? next : iterations + 1u;
+  }
+}
+
+void AppendEscaped(std::string* out, const std::string& str) {
+  for (char c : str) {
+    if (c == '"' || c == '\\')
+      out->push_back('\\');
+    out->push_back(c);
+  }
+}
+
+void AppendResult(std::string* out, const Result& result) {
+  char buf[256];
+  out->append("    {\"name\":\"");
+  AppendEscaped(out, result.name);
+  out->append("\"");
+
+  if (!result.error_message.empty()) {
+    out->append(",\"error_occurred\":true,\"error_message\":\"");
+    AppendEscaped(out, result.error_message);
+    out->append("\"}");
+    return;
+  }
+
+  double seconds = result.elapsed.ToSecondsF();
+  snprintf(buf, sizeof(buf),
+           ",\"iterations\":%" PRIu64 ",\"real_time_ns\":%" PRId64
+           ",\"ns_per_iteration\":%.3f",
+           result.iterations, result.elapsed.ToNanoseconds(),
+           static_cast<double>(result.elapsed.ToNanoseconds()) /
+               result.iterations);
+  out->append(buf);
+  if (result.bytes_processed && seconds > 0.0) {
+    snprintf(buf, sizeof(buf), ",\"bytes_per_second\":%.0f",
+             result.bytes_processed / seconds);
+    out->append(buf);
+  }
+  if (result.items_processed && seconds > 0.0) {
+    snprintf(buf, sizeof(buf), ",\"items_per_second\":%.0f",
+             result.items_processed / seconds);
+    out->append(buf);
+  }
+  out->append("}");
+}
+
+}  // namespace
+
+State::State(int64_t range, uint64_t iterations)
+    : range_(range), iterations_(iterations), remaining_(iterations) {}
+
+State::~State() {}
+
+bool State::KeepRunning() {
+  if (!started_) {
+    started_ = true;
+    ResumeTiming();
+  }
+  if (remaining_ > 0u && !error_occurred()) {
+    remaining_--;
+    return true;
+  }
+  if (timing_)
+    PauseTiming();
+  return false;
+}
+
+void State::PauseTiming() {
+  FTL_DCHECK(timing_);
+  elapsed_ += ftl::TimePoint::Now() - start_time_;
+  timing_ = false;
+}
+
+void State::ResumeTiming() {
+  FTL_DCHECK(!timing_);
+  start_time_ = ftl::TimePoint::Now();
+  timing_ = true;
+}
+
+void State::SkipWithError(std::string message) {
+  FTL_DCHECK(!message.empty());
+  error_message_ = std::move(message);
+}
+
+int RegisterBenchmark(const char* name,
+                      Function function,
+                      std::vector<int64_t> ranges) {
+  GetBenchmarks()->push_back(Benchmark{name, function, std::move(ranges)});
+  return 0;
+}
+
+int RunBenchmarks(int argc, const char* const* argv) {
+  ftl::CommandLine command_line = ftl::CommandLineFromArgcArgv(argc, argv);
+
+  std::string filter;
+  command_line.GetOptionValue("filter", &filter);
+
+  int64_t min_time_ms = 500;
+  std::string min_time_string;
+  if (command_line.GetOptionValue("min_time_ms", &min_time_string) &&
+      !ftl::StringToNumberWithError(min_time_string, &min_time_ms)) {
+    FTL_LOG(ERROR) << "Invalid --min_time_ms: " << min_time_string;
+    return 1;
+  }
+  ftl::TimeDelta min_time = ftl::TimeDelta::FromMilliseconds(min_time_ms);
+
+  std::string json("{\n  \"context\": {");
+  char buf[64];
+  snprintf(buf, sizeof(buf), "\"num_cpus\":%u,\"min_time_ms\":%" PRId64,
+           std::thread::hardware_concurrency(), min_time_ms);
+  json.append(buf);
+  json.append("},\n  \"benchmarks\": [\n");
+
+  bool first = true;
+  for (const Benchmark& benchmark : *GetBenchmarks()) {
+    std::vector<int64_t> ranges = benchmark.ranges;
+    if (ranges.empty())
+      ranges.push_back(0);
+    for (int64_t range : ranges) {
+      std::string name = benchmark.name;
+      if (!benchmark.ranges.empty())
+        name += "/" + ftl::NumberToString(range);
+      if (name.find(filter) == std::string::npos)
+        continue;
+
+      FTL_LOG(INFO) << "Running " << name;
+      Result result = Run(name, benchmark.function, range, min_time);
+      if (!first)
+        json.append(",\n");
+      first = false;
+      AppendResult(&json, result);
+    }
+  }
+  json.append("\n  ]\n}\n");
+
+  std::string output;
+  if (command_line.GetOptionValue("output", &output)) {
+    if (!files::WriteFile(output, json.data(), json.size())) {
+      FTL_LOG(ERROR) << "Failed to write " << output;
+      return 1;
+    }
+  } else {
+    fwrite(json.data(), 1, json.size(), stdout);
+  }
+  return 0;
+}
+
+}  // namespace benchmark
+}  // namespace mtl
@@ -0,0 +1,121 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_MTL_TEST_BENCHMARK_H_
+#define LIB_MTL_TEST_BENCHMARK_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "lib/ftl/macros.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/ftl/time/time_point.h"
+
+namespace mtl {
+namespace benchmark {
+
+// Controls a single run of a benchmark function.
+//
+// Typical usage:
+//
+//   void BM_Something(State* state) {
+//     ... set up ...
+//     while (state->KeepRunning()) {
+//       ... code under test ...
+//     }
+//     state->SetItemsProcessed(state->iterations());
+//   }
+//   MTL_BENCHMARK(BM_Something);
+class State {
+ public:
+  State(int64_t range, uint64_t iterations);
+  ~State();
+
+  // Returns true while the benchmark should keep iterating. The timer starts
+  // on the first call and stops on the call which returns false.
+  bool KeepRunning();
+
+  // Excludes the code between the two calls from the measured time.
+  void PauseTiming();
+  void ResumeTiming();
+
+  // The argument the benchmark was registered with, or 0.
+  int64_t range() const { return range_; }
+
+  // The number of iterations this run performs.
+  uint64_t iterations() const { return iterations_; }
+
+  // Reports the total amount of work done by the run, from which per-second
+  // rates are derived.
+  void SetBytesProcessed(int64_t bytes) { bytes_processed_ = bytes; }
+  void SetItemsProcessed(int64_t items) { items_processed_ = items; }
+
+  // Marks the run as failed; the benchmark is reported with |message|.
+  void SkipWithError(std::string message);
+
+  ftl::TimeDelta elapsed() const { return elapsed_; }
+  int64_t bytes_processed() const { return bytes_processed_; }
+  int64_t items_processed() const { return items_processed_; }
+  bool error_occurred() const { return !error_message_.empty(); }
+  const std::string& error_message() const { return error_message_; }
+
+ private:
+  const int64_t range_;
+  const uint64_t iterations_;
+  uint64_t remaining_;
+  bool started_ = false;
+  bool timing_ = false;
+  ftl::TimePoint start_time_;
+  ftl::TimeDelta elapsed_;
+  int64_t bytes_processed_ = 0;
+  int64_t items_processed_ = 0;
+  std::string error_message_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(State);
+};
+
+using Function = void (*)(State* state);
+
+// Registers |function| under |name|. When |ranges| is not empty, the
+// benchmark is run once per range, named "<name>/<range>".
+// Returns a dummy value so that registration can happen during static
+// initialization.
+int RegisterBenchmark(const char* name,
+                      Function function,
+                      std::vector<int64_t> ranges = std::vector<int64_t>());
+
+// Runs all registered benchmarks and writes the results as JSON.
+//
+// Recognized options:
+//   --filter=<substring>  only run benchmarks whose name contains <substring>
+//   --min_time_ms=<n>     grow the iteration count until a run takes at least
+//                         <n> milliseconds (default 500)
+//   --output=<path>       write the JSON report to <path> instead of stdout
+//
+// Returns 0 on success.
+int RunBenchmarks(int argc, const char* const* argv);
+
+}  // namespace benchmark
+}  // namespace mtl
+
+#define MTL_BENCHMARK_INTERNAL_CONCAT2(a, b) a##b
+#define MTL_BENCHMARK_INTERNAL_CONCAT(a, b) MTL_BENCHMARK_INTERNAL_CONCAT2(a, b)
+
+// Registers a benchmark function.
+#define MTL_BENCHMARK(function)                                      \
+  static int MTL_BENCHMARK_INTERNAL_CONCAT(mtl_benchmark_, __LINE__) \
+      __attribute__((unused)) =                                      \
+          ::mtl::benchmark::RegisterBenchmark(#function, function)
+
+// Registers a benchmark function which is run once for each of the given
+// ranges, available as |State::range()|.
+#define MTL_BENCHMARK_RANGES(function, ...)                          \
+  static int MTL_BENCHMARK_INTERNAL_CONCAT(mtl_benchmark_, __LINE__) \
+      __attribute__((unused)) = ::mtl::benchmark::RegisterBenchmark( \
+          #function, function, {__VA_ARGS__})
+
+#endif  // LIB_MTL_TEST_BENCHMARK_H_
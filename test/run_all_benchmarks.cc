@@ -0,0 +1,9 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/test/benchmark.h"
+
+int main(int argc, char** argv) {
+  return mtl::benchmark::RunBenchmarks(argc, argv);
+}
@@ -6,7 +6,6 @@
 
 #include <utility>
 
-#include "lib/mtl/handles/object_info.h"
 #include "lib/mtl/tasks/incoming_task_queue.h"
 #include "lib/mtl/tasks/message_loop.h"
 
@@ -14,11 +13,8 @@ namespace mtl {
 namespace {
 
 void RunMessageLoop(ftl::RefPtr<internal::IncomingTaskQueue> task_queue,
-                    std::string thread_name) {
-  // Note: The kernel's default thread name is an empty string so we only
-  // need to set the name when we want it to be non-empty.
-  if (!thread_name.empty())
-    SetCurrentThreadName(thread_name);
+                    ThreadOptions options) {
+  ApplyThreadOptions(options);
 
   MessageLoop message_loop(std::move(task_queue));
   message_loop.Run();
@@ -28,10 +24,16 @@ void RunMessageLoop(ftl::RefPtr<internal::IncomingTaskQueue> task_queue,
 
 std::thread CreateThread(ftl::RefPtr<ftl::TaskRunner>* task_runner,
                          std::string thread_name) {
+  ThreadOptions options;
+  options.name = std::move(thread_name);
+  return CreateThread(task_runner, options);
+}
+
+std::thread CreateThread(ftl::RefPtr<ftl::TaskRunner>* task_runner,
+                         const ThreadOptions& options) {
   auto incoming_queue = ftl::MakeRefCounted<internal::IncomingTaskQueue>();
   *task_runner = incoming_queue;
-  return std::thread(RunMessageLoop, std::move(incoming_queue),
-                     std::move(thread_name));
+  return std::thread(RunMessageLoop, std::move(incoming_queue), options);
 }
 
 }  // namespace mtl
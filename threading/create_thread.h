@@ -10,6 +10,7 @@
 
 #include "lib/ftl/ftl_export.h"
 #include "lib/ftl/tasks/task_runner.h"
+#include "lib/mtl/threading/thread_options.h"
 
 namespace mtl {
 
@@ -20,6 +21,14 @@ namespace mtl {
 FTL_EXPORT std::thread CreateThread(ftl::RefPtr<ftl::TaskRunner>* task_runner,
                                     std::string thread_name = "message loop");
 
+// Creates a thread with a |MessageLoop| and applies the name in |options| to
+// it.
+//
+// |options.stack_size| is ignored since |std::thread| always uses the default
+// stack size. Use |mtl::Thread| when the stack size matters.
+FTL_EXPORT std::thread CreateThread(ftl::RefPtr<ftl::TaskRunner>* task_runner,
+                                    const ThreadOptions& options);
+
 }  // namespace mtl
 
 #endif  // LIB_MTL_THREADING_CREATE_THREAD_H_
@@ -0,0 +1,60 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/threading/create_thread.h"
+
+#include "lib/mtl/tasks/message_loop.h"
+#include "lib/mtl/test/benchmark.h"
+
+namespace mtl {
+namespace {
+
+using benchmark::State;
+
+// Measures the round trip latency of posting a task to a thread created with
+// |CreateThread| which immediately posts a reply back.
+void CrossThreadPostRoundTrip(State* state) {
+  MessageLoop loop;
+  ftl::RefPtr<ftl::TaskRunner> task_runner;
+  std::thread thread = CreateThread(&task_runner, "benchmark");
+
+  ftl::RefPtr<ftl::TaskRunner> reply_runner = loop.task_runner();
+  while (state->KeepRunning()) {
+    task_runner->PostTask([reply_runner, &loop] {
+      reply_runner->PostTask([&loop] { loop.QuitNow(); });
+    });
+    loop.Run();
+  }
+  state->SetItemsProcessed(state->iterations());
+
+  task_runner->PostTask([] { MessageLoop::GetCurrent()->QuitNow(); });
+  thread.join();
+}
+MTL_BENCHMARK(CrossThreadPostRoundTrip);
+
+// Measures one-way throughput of posting |range| tasks to another thread.
+void CrossThreadPostThroughput(State* state) {
+  MessageLoop loop;
+  ftl::RefPtr<ftl::TaskRunner> task_runner;
+  std::thread thread = CreateThread(&task_runner, "benchmark");
+
+  ftl::RefPtr<ftl::TaskRunner> reply_runner = loop.task_runner();
+  const int64_t task_count = state->range();
+  while (state->KeepRunning()) {
+    for (int64_t i = 0; i < task_count; i++)
+      task_runner->PostTask([] {});
+    task_runner->PostTask([reply_runner, &loop] {
+      reply_runner->PostTask([&loop] { loop.QuitNow(); });
+    });
+    loop.Run();
+  }
+  state->SetItemsProcessed(state->iterations() * task_count);
+
+  task_runner->PostTask([] { MessageLoop::GetCurrent()->QuitNow(); });
+  thread.join();
+}
+MTL_BENCHMARK_RANGES(CrossThreadPostThroughput, 1024);
+
+}  // namespace
+}  // namespace mtl
@@ -41,5 +41,22 @@ TEST(CreateThread, CustomName) {
   EXPECT_TRUE(task_ran);
 }
 
+TEST(CreateThread, Options) {
+  ThreadOptions options;
+  options.name = "with options";
+  ftl::RefPtr<ftl::TaskRunner> task_runner;
+  std::thread child = CreateThread(&task_runner, options);
+
+  bool task_ran = false;
+  task_runner->PostTask([&task_ran]() {
+    task_ran = true;
+    EXPECT_EQ("with options", mtl::GetCurrentThreadName());
+    mtl::MessageLoop::GetCurrent()->PostQuitTask();
+  });
+
+  child.join();
+  EXPECT_TRUE(task_ran);
+}
+
 }  // namespace
 }  // namespace mtl
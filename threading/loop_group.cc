@@ -0,0 +1,211 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/threading/loop_group.h"
+
+#include <atomic>
+#include <functional>
+#include <utility>
+
+#include "lib/ftl/logging.h"
+#include "lib/ftl/synchronization/waitable_event.h"
+#include "lib/mtl/tasks/message_loop.h"
+#include "lib/mtl/threading/thread.h"
+
+namespace mtl {
+
+struct LoopGroup::Shard {
+  // Registers itself with the shard's loop on behalf of a handler, so that
+  // the group learns when the loop drops the handler after an error.
+  class Registration : public MessageLoopHandler {
+   public:
+    Registration(LoopGroup* group,
+                 Shard* shard,
+                 HandlerKey key,
+                 MessageLoopHandler* handler)
+        : group_(group), shard_(shard), key_(key), handler_(handler) {}
+
+    MessageLoop::HandlerKey loop_key = 0u;
+
+   private:
+    void OnHandleReady(mx_handle_t handle,
+                       mx_signals_t pending,
+                       uint64_t count) override {
+      handler_->OnHandleReady(handle, pending, count);
+    }
+
+    void OnHandleError(mx_handle_t handle, mx_status_t error) override {
+      // The loop removes the handler once this returns, so release its key
+      // now. This deletes |this|.
+      MessageLoopHandler* handler = handler_;
+      LoopGroup* group = group_;
+      HandlerKey key = key_;
+      shard_->loop_keys.erase(key);
+      group->ReleaseKey(key);
+      handler->OnHandleError(handle, error);
+    }
+
+    LoopGroup* const group_;
+    Shard* const shard_;
+    const HandlerKey key_;
+    MessageLoopHandler* const handler_;
+  };
+
+  Thread thread;
+  ftl::RefPtr<ftl::TaskRunner> task_runner;
+  std::atomic<size_t> handler_count{0u};
+
+  // Maps group keys to the registrations with the shard's own loop.
+  // Only accessed on |thread|.
+  std::unordered_map<HandlerKey, std::unique_ptr<Registration>> loop_keys;
+
+  void RemoveHandlerOnThread(HandlerKey key) {
+    FTL_DCHECK(task_runner->RunsTasksOnCurrentThread());
+    auto it = loop_keys.find(key);
+    if (it == loop_keys.end())
+      return;
+    MessageLoop::GetCurrent()->RemoveHandler(it->second->loop_key);
+    loop_keys.erase(it);
+  }
+};
+
+LoopGroup::LoopGroup(size_t thread_count, Placement placement)
+    : placement_(placement) {
+  FTL_DCHECK(thread_count > 0u);
+
+  for (size_t i = 0; i < thread_count; i++) {
+    auto shard = std::make_unique<Shard>();
+    shard->task_runner = shard->thread.TaskRunner();
+    bool started = shard->thread.Run();
+    FTL_CHECK(started) << "Failed to start loop group thread";
+    shards_.push_back(std::move(shard));
+  }
+}
+
+LoopGroup::~LoopGroup() {
+  for (auto& shard : shards_) {
+    shard->task_runner->PostTask([] { MessageLoop::GetCurrent()->QuitNow(); });
+  }
+  for (auto& shard : shards_)
+    shard->thread.Join();
+}
+
+ftl::RefPtr<ftl::TaskRunner> LoopGroup::task_runner(size_t index) const {
+  FTL_DCHECK(index < shards_.size());
+  return shards_[index]->task_runner;
+}
+
+LoopGroup::HandlerKey LoopGroup::AddHandler(MessageLoopHandler* handler,
+                                            mx_handle_t handle,
+                                            mx_signals_t trigger,
+                                            ftl::TimeDelta timeout) {
+  FTL_DCHECK(handler);
+  FTL_DCHECK(handle != MX_HANDLE_INVALID);
+
+  size_t index = ChooseShard(handle);
+  Shard* shard = shards_[index].get();
+  shard->handler_count.fetch_add(1u, std::memory_order_relaxed);
+
+  HandlerKey key;
+  {
+    ftl::MutexLocker locker(&mutex_);
+    key = next_handler_key_++;
+    handler_shards_.emplace(key, index);
+  }
+
+  shard->task_runner->PostTask([this, shard, key, handler, handle, trigger,
+                                timeout] {
+    // The handler may have been removed before it was ever registered.
+    if (!FindShard(key))
+      return;
+    auto registration =
+        std::make_unique<Shard::Registration>(this, shard, key, handler);
+    registration->loop_key = MessageLoop::GetCurrent()->AddHandler(
+        registration.get(), handle, trigger, timeout);
+    shard->loop_keys[key] = std::move(registration);
+  });
+  return key;
+}
+
+void LoopGroup::RemoveHandler(HandlerKey key) {
+  Shard* shard;
+  {
+    ftl::MutexLocker locker(&mutex_);
+    auto it = handler_shards_.find(key);
+    if (it == handler_shards_.end())
+      return;
+    shard = shards_[it->second].get();
+    handler_shards_.erase(it);
+  }
+  shard->handler_count.fetch_sub(1u, std::memory_order_relaxed);
+
+  if (shard->task_runner->RunsTasksOnCurrentThread()) {
+    shard->RemoveHandlerOnThread(key);
+    return;
+  }
+
+  // The pending registration, if any, is ahead of this task in the queue.
+  ftl::AutoResetWaitableEvent removed;
+  shard->task_runner->PostTask([shard, key, &removed] {
+    shard->RemoveHandlerOnThread(key);
+    removed.Signal();
+  });
+  removed.Wait();
+}
+
+ftl::RefPtr<ftl::TaskRunner> LoopGroup::TaskRunnerForHandler(
+    HandlerKey key) const {
+  Shard* shard = FindShard(key);
+  return shard ? shard->task_runner : nullptr;
+}
+
+bool LoopGroup::PostTaskForHandler(HandlerKey key, ftl::Closure task) {
+  Shard* shard = FindShard(key);
+  if (!shard)
+    return false;
+  shard->task_runner->PostTask(std::move(task));
+  return true;
+}
+
+size_t LoopGroup::handler_count(size_t index) const {
+  FTL_DCHECK(index < shards_.size());
+  return shards_[index]->handler_count.load(std::memory_order_relaxed);
+}
+
+size_t LoopGroup::ChooseShard(mx_handle_t handle) const {
+  if (placement_ == Placement::kHash)
+    return std::hash<mx_handle_t>()(handle) % shards_.size();
+
+  size_t best = 0u;
+  size_t best_count = handler_count(0u);
+  for (size_t i = 1u; i < shards_.size() && best_count; i++) {
+    size_t count = handler_count(i);
+    if (count < best_count) {
+      best = i;
+      best_count = count;
+    }
+  }
+  return best;
+}
+
+void LoopGroup::ReleaseKey(HandlerKey key) {
+  Shard* shard;
+  {
+    ftl::MutexLocker locker(&mutex_);
+    auto it = handler_shards_.find(key);
+    if (it == handler_shards_.end())
+      return;
+    shard = shards_[it->second].get();
+    handler_shards_.erase(it);
+  }
+  shard->handler_count.fetch_sub(1u, std::memory_order_relaxed);
+}
+
+LoopGroup::Shard* LoopGroup::FindShard(HandlerKey key) const {
+  ftl::MutexLocker locker(&mutex_);
+  auto it = handler_shards_.find(key);
+  return it == handler_shards_.end() ? nullptr : shards_[it->second].get();
+}
+
+}  // namespace mtl
@@ -0,0 +1,114 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_MTL_THREADING_LOOP_GROUP_H_
+#define LIB_MTL_THREADING_LOOP_GROUP_H_
+
+#include <magenta/types.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/ftl/ftl_export.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/synchronization/mutex.h"
+#include "lib/ftl/synchronization/thread_annotations.h"
+#include "lib/ftl/tasks/task_runner.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/mtl/tasks/message_loop_handler.h"
+
+namespace mtl {
+class Thread;
+
+// Runs a fixed number of |mtl::Thread|s, each with its own |MessageLoop|, and
+// spreads handlers across them.
+//
+// Each handler is assigned to one loop when it is added and all of its
+// callbacks run on that loop's thread, so a handler never observes
+// concurrent calls. Use |TaskRunnerForHandler| to run code on the thread
+// which owns a given handler.
+//
+// This object is thread-safe.
+class FTL_EXPORT LoopGroup {
+ public:
+  using HandlerKey = uint64_t;
+
+  // How |AddHandler| chooses a loop for a new handler.
+  enum class Placement {
+    // Hashes the handle value, so placement is stable for a given handle.
+    kHash,
+    // Picks the loop with the fewest registered handlers.
+    kLeastLoaded,
+  };
+
+  // Starts |thread_count| threads, which must be at least one.
+  explicit LoopGroup(size_t thread_count,
+                     Placement placement = Placement::kLeastLoaded);
+
+  // Quits all loops and joins their threads. Handlers which are still
+  // registered receive |OnHandleError| with |MX_ERR_CANCELED| on their own
+  // thread.
+  ~LoopGroup();
+
+  size_t thread_count() const { return shards_.size(); }
+
+  // Returns the task runner of the loop at |index|.
+  ftl::RefPtr<ftl::TaskRunner> task_runner(size_t index) const;
+
+  // Adds |handler| to one of the loops. See |MessageLoop::AddHandler|.
+  //
+  // The registration itself happens asynchronously on the chosen loop's
+  // thread. The returned group-scoped key is always non-zero.
+  HandlerKey AddHandler(MessageLoopHandler* handler,
+                        mx_handle_t handle,
+                        mx_signals_t trigger,
+                        ftl::TimeDelta timeout = ftl::TimeDelta::Max());
+
+  // Removes the handler identified by |key|. Does nothing if the key is
+  // unknown, including after the handler received |OnHandleError|, which
+  // releases its key automatically.
+  //
+  // When called from a thread other than the handler's own, blocks until the
+  // handler's loop has removed it, so the handler may be destroyed as soon as
+  // this returns. Because of this, the loops of one group must not remove
+  // each other's handlers: two loop threads doing so at the same time wait on
+  // each other forever. Post the removal to the handler's own loop with
+  // |PostTaskForHandler| instead.
+  void RemoveHandler(HandlerKey key);
+
+  // Returns the task runner of the loop which owns the handler identified by
+  // |key|, or null if the key is unknown.
+  ftl::RefPtr<ftl::TaskRunner> TaskRunnerForHandler(HandlerKey key) const;
+
+  // Posts |task| to the loop which owns the handler identified by |key|.
+  // Returns false if the key is unknown.
+  bool PostTaskForHandler(HandlerKey key, ftl::Closure task);
+
+  // Returns the number of handlers currently assigned to the loop at |index|.
+  size_t handler_count(size_t index) const;
+
+ private:
+  struct Shard;
+
+  // Forgets |key| after its handler was removed from its loop by an error.
+  void ReleaseKey(HandlerKey key);
+
+  size_t ChooseShard(mx_handle_t handle) const;
+  Shard* FindShard(HandlerKey key) const;
+
+  const Placement placement_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  mutable ftl::Mutex mutex_;
+  HandlerKey next_handler_key_ FTL_GUARDED_BY(mutex_) = 1u;
+  std::unordered_map<HandlerKey, size_t> handler_shards_
+      FTL_GUARDED_BY(mutex_);
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(LoopGroup);
+};
+
+}  // namespace mtl
+
+#endif  // LIB_MTL_THREADING_LOOP_GROUP_H_
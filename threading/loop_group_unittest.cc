@@ -0,0 +1,186 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/threading/loop_group.h"
+
+#include <magenta/syscalls.h>
+#include <mx/event.h>
+
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "lib/ftl/synchronization/waitable_event.h"
+
+namespace mtl {
+namespace {
+
+class RecordingHandler : public MessageLoopHandler {
+ public:
+  RecordingHandler() {}
+  ~RecordingHandler() override {}
+
+  void WaitForReady() { ready_.Wait(); }
+  std::thread::id ready_thread() const { return ready_thread_; }
+
+  void OnHandleReady(mx_handle_t handle,
+                     mx_signals_t pending,
+                     uint64_t count) override {
+    // Clear the signal so that the handler is only called once.
+    mx_object_signal(handle, MX_EVENT_SIGNALED, 0u);
+    ready_thread_ = std::this_thread::get_id();
+    ready_.Signal();
+  }
+
+ private:
+  ftl::AutoResetWaitableEvent ready_;
+  std::thread::id ready_thread_;
+};
+
+std::thread::id GetTaskThread(const ftl::RefPtr<ftl::TaskRunner>& runner) {
+  std::thread::id id;
+  ftl::AutoResetWaitableEvent done;
+  runner->PostTask([&id, &done] {
+    id = std::this_thread::get_id();
+    done.Signal();
+  });
+  done.Wait();
+  return id;
+}
+
+TEST(LoopGroup, LeastLoadedPlacementSpreadsHandlers) {
+  LoopGroup group(2u);
+  mx::event event1, event2;
+  ASSERT_EQ(MX_OK, mx::event::create(0u, &event1));
+  ASSERT_EQ(MX_OK, mx::event::create(0u, &event2));
+
+  RecordingHandler handler1, handler2;
+  LoopGroup::HandlerKey key1 =
+      group.AddHandler(&handler1, event1.get(), MX_EVENT_SIGNALED);
+  LoopGroup::HandlerKey key2 =
+      group.AddHandler(&handler2, event2.get(), MX_EVENT_SIGNALED);
+  EXPECT_NE(0u, key1);
+  EXPECT_NE(key1, key2);
+  EXPECT_EQ(1u, group.handler_count(0u));
+  EXPECT_EQ(1u, group.handler_count(1u));
+
+  EXPECT_EQ(MX_OK, event1.signal(0u, MX_EVENT_SIGNALED));
+  EXPECT_EQ(MX_OK, event2.signal(0u, MX_EVENT_SIGNALED));
+  handler1.WaitForReady();
+  handler2.WaitForReady();
+  EXPECT_NE(handler1.ready_thread(), handler2.ready_thread());
+  EXPECT_NE(std::this_thread::get_id(), handler1.ready_thread());
+
+  group.RemoveHandler(key1);
+  group.RemoveHandler(key2);
+  EXPECT_EQ(0u, group.handler_count(0u));
+  EXPECT_EQ(0u, group.handler_count(1u));
+}
+
+TEST(LoopGroup, TasksRunOnHandlerThread) {
+  LoopGroup group(3u);
+  mx::event event;
+  ASSERT_EQ(MX_OK, mx::event::create(0u, &event));
+
+  RecordingHandler handler;
+  LoopGroup::HandlerKey key =
+      group.AddHandler(&handler, event.get(), MX_EVENT_SIGNALED);
+  EXPECT_EQ(MX_OK, event.signal(0u, MX_EVENT_SIGNALED));
+  handler.WaitForReady();
+
+  ftl::RefPtr<ftl::TaskRunner> runner = group.TaskRunnerForHandler(key);
+  ASSERT_TRUE(runner);
+  EXPECT_EQ(handler.ready_thread(), GetTaskThread(runner));
+
+  std::thread::id task_thread;
+  ftl::AutoResetWaitableEvent done;
+  EXPECT_TRUE(group.PostTaskForHandler(key, [&task_thread, &done] {
+    task_thread = std::this_thread::get_id();
+    done.Signal();
+  }));
+  done.Wait();
+  EXPECT_EQ(handler.ready_thread(), task_thread);
+
+  group.RemoveHandler(key);
+  EXPECT_FALSE(group.TaskRunnerForHandler(key));
+}
+
+TEST(LoopGroup, HashPlacementIsStable) {
+  LoopGroup group(4u, LoopGroup::Placement::kHash);
+  mx::event event;
+  ASSERT_EQ(MX_OK, mx::event::create(0u, &event));
+
+  RecordingHandler handler;
+  LoopGroup::HandlerKey key1 =
+      group.AddHandler(&handler, event.get(), MX_EVENT_SIGNALED);
+  LoopGroup::HandlerKey key2 =
+      group.AddHandler(&handler, event.get(), MX_EVENT_SIGNALED);
+  EXPECT_EQ(group.TaskRunnerForHandler(key1),
+            group.TaskRunnerForHandler(key2));
+
+  group.RemoveHandler(key1);
+  group.RemoveHandler(key2);
+}
+
+TEST(LoopGroup, RemoveFromHandlerThread) {
+  LoopGroup group(1u);
+  mx::event event;
+  ASSERT_EQ(MX_OK, mx::event::create(0u, &event));
+
+  RecordingHandler handler;
+  LoopGroup::HandlerKey key =
+      group.AddHandler(&handler, event.get(), MX_EVENT_SIGNALED);
+  ftl::AutoResetWaitableEvent done;
+  group.PostTaskForHandler(key, [&group, &done, key] {
+    group.RemoveHandler(key);
+    done.Signal();
+  });
+  done.Wait();
+  EXPECT_EQ(0u, group.handler_count(0u));
+}
+
+TEST(LoopGroup, UnknownKey) {
+  LoopGroup group(1u);
+  EXPECT_FALSE(group.PostTaskForHandler(42u, [] {}));
+  EXPECT_FALSE(group.TaskRunnerForHandler(42u));
+  group.RemoveHandler(42u);
+}
+
+class ErrorHandler : public MessageLoopHandler {
+ public:
+  ErrorHandler() {}
+  ~ErrorHandler() override {}
+
+  void WaitForError() { error_.Wait(); }
+  mx_status_t status() const { return status_; }
+
+  void OnHandleError(mx_handle_t handle, mx_status_t error) override {
+    status_ = error;
+    error_.Signal();
+  }
+
+ private:
+  ftl::AutoResetWaitableEvent error_;
+  mx_status_t status_ = MX_OK;
+};
+
+TEST(LoopGroup, ErrorReleasesKey) {
+  LoopGroup group(1u);
+  mx::event event;
+  ASSERT_EQ(MX_OK, mx::event::create(0u, &event));
+
+  ErrorHandler handler;
+  LoopGroup::HandlerKey key =
+      group.AddHandler(&handler, event.get(), MX_EVENT_SIGNALED,
+                       ftl::TimeDelta::FromMilliseconds(10));
+  handler.WaitForError();
+  EXPECT_EQ(MX_ERR_TIMED_OUT, handler.status());
+  EXPECT_EQ(0u, group.handler_count(0u));
+  EXPECT_FALSE(group.TaskRunnerForHandler(key));
+
+  // Removing the released key does nothing.
+  group.RemoveHandler(key);
+}
+
+}  // namespace
+}  // namespace mtl
@@ -4,6 +4,7 @@
 
 #include "lib/mtl/threading/thread.h"
 
+#include "lib/ftl/logging.h"
 #include "lib/mtl/tasks/incoming_task_queue.h"
 #include "lib/mtl/tasks/message_loop.h"
 
@@ -19,6 +20,55 @@ bool Thread::Run(size_t stack_size) {
   return thread_.Run(stack_size);
 }
 
+bool Thread::Run(const ThreadOptions& options) {
+  // |options_| is only read by the new thread, which |ftl::Thread::Run|
+  // starts after this assignment.
+  options_ = options;
+  return thread_.Run(options.stack_size);
+}
+
+bool Thread::Stop(StopMode mode,
+                  ftl::TimeDelta timeout,
+                  size_t* dropped_task_count) {
+  FTL_DCHECK(!task_runner_->RunsTasksOnCurrentThread());
+
+  if (!thread_.IsRunning()) {
+    if (dropped_task_count) {
+      ftl::MutexLocker locker(&mutex_);
+      *dropped_task_count = dropped_task_count_;
+    }
+    return true;
+  }
+
+  {
+    ftl::MutexLocker locker(&mutex_);
+    // A later |kImmediate| cuts short an earlier |kDrain|, never the reverse.
+    bool quit = !stop_requested_ || (mode == StopMode::kImmediate &&
+                                     stop_mode_ == StopMode::kDrain);
+    if (quit) {
+      stop_requested_ = true;
+      stop_mode_ = mode;
+      // If the loop has not been created yet, |Main| sees |stop_requested_|.
+      if (message_loop_)
+        message_loop_->QuitFromAnyThread();
+    }
+  }
+
+  if (timeout == ftl::TimeDelta::Max()) {
+    exited_.Wait();
+  } else if (exited_.WaitWithTimeout(timeout)) {
+    return false;
+  }
+
+  bool joined = thread_.Join();
+  FTL_DCHECK(joined);
+  if (dropped_task_count) {
+    ftl::MutexLocker locker(&mutex_);
+    *dropped_task_count = dropped_task_count_;
+  }
+  return true;
+}
+
 bool Thread::IsRunning() const {
   return thread_.IsRunning();
 }
@@ -28,8 +78,38 @@ ftl::RefPtr<ftl::TaskRunner> Thread::TaskRunner() const {
 }
 
 void Thread::Main(void) {
+  ApplyThreadOptions(options_);
   mtl::MessageLoop message_loop(task_runner_);
-  message_loop.Run();
+
+  bool stop_requested;
+  {
+    ftl::MutexLocker locker(&mutex_);
+    message_loop_ = &message_loop;
+    stop_requested = stop_requested_;
+  }
+  if (!stop_requested)
+    message_loop.Run();
+
+  // The loop also quits when a task calls |QuitNow|, in which case there is
+  // nothing to drain. Otherwise drain, re-checking the mode under the mutex
+  // before each pass: a |kImmediate| which lands while a run is resetting the
+  // loop's quit state loses its quit, but not the mode it recorded.
+  for (;;) {
+    {
+      ftl::MutexLocker locker(&mutex_);
+      if (!stop_requested_ || stop_mode_ != StopMode::kDrain)
+        break;
+    }
+    if (message_loop.RunUntilIdle())
+      break;
+  }
+
+  {
+    ftl::MutexLocker locker(&mutex_);
+    message_loop_ = nullptr;
+    dropped_task_count_ = message_loop.pending_task_count();
+  }
+  exited_.Signal();
 }
 
 bool Thread::Join() {
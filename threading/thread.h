@@ -8,10 +8,16 @@
 #include "lib/ftl/ftl_export.h"
 #include "lib/ftl/macros.h"
 #include "lib/ftl/memory/ref_ptr.h"
+#include "lib/ftl/synchronization/mutex.h"
+#include "lib/ftl/synchronization/thread_annotations.h"
+#include "lib/ftl/synchronization/waitable_event.h"
 #include "lib/ftl/tasks/task_runner.h"
 #include "lib/ftl/threading/thread.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/mtl/threading/thread_options.h"
 
 namespace mtl {
+class MessageLoop;
 
 namespace internal {
 class IncomingTaskQueue;
@@ -19,19 +25,56 @@ class IncomingTaskQueue;
 
 class FTL_EXPORT Thread {
  public:
-  static constexpr size_t default_stack_size = 1 * 1024 * 1024;
+  static constexpr size_t default_stack_size = ThreadOptions::kDefaultStackSize;
+
+  // How |Stop| treats the tasks which are queued when it is called.
+  enum class StopMode {
+    // Runs every task which is due, including tasks posted by those tasks,
+    // then quits.
+    kDrain,
+    // Quits once the task in progress, if any, returns.
+    kImmediate,
+  };
 
   Thread();
   ~Thread();
   bool Run(size_t stack_size = default_stack_size);
+
+  // Starts the thread with the given name and stack size.
+  bool Run(const ThreadOptions& options);
+
   bool IsRunning() const;
   bool Join();
+
+  // Quits the thread's message loop according to |mode| and joins the thread.
+  // Tasks which have not run by the time the loop quits, including delayed
+  // tasks which are not due yet, are dropped and their number is stored in
+  // |dropped_task_count| if it is not null. Tasks posted while the thread is
+  // exiting may be dropped without being counted.
+  //
+  // Returns false if the thread did not exit within |timeout|. It then keeps
+  // stopping in the background; call |Stop| again, possibly with |kImmediate|,
+  // to wait for it. Returns true immediately if the thread is not running.
+  //
+  // Must not be called from the thread itself.
+  bool Stop(StopMode mode,
+            ftl::TimeDelta timeout = ftl::TimeDelta::Max(),
+            size_t* dropped_task_count = nullptr);
+
   ftl::RefPtr<ftl::TaskRunner> TaskRunner() const;
 
  private:
   void Main();
 
   ftl::Thread thread_;
+  ThreadOptions options_;
+
+  ftl::Mutex mutex_;
+  MessageLoop* message_loop_ FTL_GUARDED_BY(mutex_) = nullptr;
+  bool stop_requested_ FTL_GUARDED_BY(mutex_) = false;
+  StopMode stop_mode_ FTL_GUARDED_BY(mutex_) = StopMode::kDrain;
+  size_t dropped_task_count_ FTL_GUARDED_BY(mutex_) = 0u;
+  ftl::ManualResetWaitableEvent exited_;
   ftl::RefPtr<mtl::internal::IncomingTaskQueue> task_runner_;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(Thread);
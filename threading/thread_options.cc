@@ -0,0 +1,20 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/threading/thread_options.h"
+
+#include "lib/mtl/handles/object_info.h"
+
+namespace mtl {
+
+constexpr size_t ThreadOptions::kDefaultStackSize;
+
+void ApplyThreadOptions(const ThreadOptions& options) {
+  // Note: The kernel's default thread name is an empty string so we only
+  // need to set the name when we want it to be non-empty.
+  if (!options.name.empty())
+    SetCurrentThreadName(options.name);
+}
+
+}  // namespace mtl
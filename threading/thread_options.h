@@ -0,0 +1,33 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_MTL_THREADING_THREAD_OPTIONS_H_
+#define LIB_MTL_THREADING_THREAD_OPTIONS_H_
+
+#include <stddef.h>
+
+#include <string>
+
+#include "lib/ftl/ftl_export.h"
+
+namespace mtl {
+
+// Properties of a thread started by |mtl::Thread| or |mtl::CreateThread|.
+struct ThreadOptions {
+  static constexpr size_t kDefaultStackSize = 1 * 1024 * 1024;
+
+  // Name of the thread. Left as the platform's default when empty.
+  std::string name;
+
+  // Size of the thread's stack, in bytes.
+  size_t stack_size = kDefaultStackSize;
+};
+
+// Applies the name in |options| to the calling thread. |stack_size| is
+// ignored since the thread already exists.
+FTL_EXPORT void ApplyThreadOptions(const ThreadOptions& options);
+
+}  // namespace mtl
+
+#endif  // LIB_MTL_THREADING_THREAD_OPTIONS_H_
@@ -0,0 +1,35 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/threading/thread_options.h"
+
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "lib/mtl/handles/object_info.h"
+
+namespace mtl {
+namespace {
+
+TEST(ThreadOptions, Name) {
+  std::thread thread([] {
+    ThreadOptions options;
+    options.name = "named";
+    ApplyThreadOptions(options);
+    EXPECT_EQ("named", GetCurrentThreadName());
+  });
+  thread.join();
+}
+
+TEST(ThreadOptions, DefaultsChangeNothing) {
+  std::thread thread([] {
+    std::string name = GetCurrentThreadName();
+    ApplyThreadOptions(ThreadOptions());
+    EXPECT_EQ(name, GetCurrentThreadName());
+  });
+  thread.join();
+}
+
+}  // namespace
+}  // namespace mtl
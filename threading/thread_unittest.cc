@@ -5,6 +5,8 @@
 #include "lib/mtl/threading/thread.h"
 
 #include "gtest/gtest.h"
+#include "lib/ftl/synchronization/waitable_event.h"
+#include "lib/mtl/handles/object_info.h"
 #include "lib/mtl/tasks/message_loop.h"
 
 namespace mtl {
@@ -20,5 +22,119 @@ TEST(Thread, Control) {
   EXPECT_TRUE(thread.Join());
 }
 
+TEST(Thread, RunWithOptions) {
+  ThreadOptions options;
+  options.name = "options thread";
+  options.stack_size = 256 * 1024;
+  Thread thread;
+  EXPECT_TRUE(thread.Run(options));
+
+  std::string name;
+  thread.TaskRunner()->PostTask([&name] {
+    name = mtl::GetCurrentThreadName();
+    mtl::MessageLoop::GetCurrent()->QuitNow();
+  });
+  EXPECT_TRUE(thread.Join());
+  EXPECT_EQ("options thread", name);
+}
+
+TEST(Thread, StopNotRunning) {
+  Thread thread;
+  size_t dropped_task_count = 1u;
+  EXPECT_TRUE(thread.Stop(Thread::StopMode::kDrain, ftl::TimeDelta::Max(),
+                          &dropped_task_count));
+  EXPECT_EQ(0u, dropped_task_count);
+}
+
+TEST(Thread, StopDrainsTasks) {
+  Thread thread;
+  EXPECT_TRUE(thread.Run());
+
+  int tasks_run = 0;
+  for (int i = 0; i < 10; i++) {
+    thread.TaskRunner()->PostTask([&thread, &tasks_run] {
+      tasks_run++;
+      // Tasks posted while draining run too.
+      thread.TaskRunner()->PostTask([&tasks_run] { tasks_run++; });
+    });
+  }
+  thread.TaskRunner()->PostDelayedTask([] {}, ftl::TimeDelta::FromSeconds(60));
+
+  size_t dropped_task_count = 0u;
+  EXPECT_TRUE(thread.Stop(Thread::StopMode::kDrain, ftl::TimeDelta::Max(),
+                          &dropped_task_count));
+  EXPECT_FALSE(thread.IsRunning());
+  EXPECT_EQ(20, tasks_run);
+  EXPECT_EQ(1u, dropped_task_count);
+}
+
+TEST(Thread, StopImmediateDropsTasks) {
+  Thread thread;
+  EXPECT_TRUE(thread.Run());
+
+  ftl::ManualResetWaitableEvent started;
+  ftl::ManualResetWaitableEvent unblock;
+  thread.TaskRunner()->PostTask([&started, &unblock] {
+    started.Signal();
+    unblock.Wait();
+  });
+  int tasks_run = 0;
+  for (int i = 0; i < 5; i++)
+    thread.TaskRunner()->PostTask([&tasks_run] { tasks_run++; });
+  started.Wait();
+
+  // The blocked task keeps the thread from exiting.
+  EXPECT_FALSE(thread.Stop(Thread::StopMode::kImmediate,
+                           ftl::TimeDelta::FromMilliseconds(10)));
+  EXPECT_TRUE(thread.IsRunning());
+
+  unblock.Signal();
+  size_t dropped_task_count = 0u;
+  EXPECT_TRUE(thread.Stop(Thread::StopMode::kImmediate, ftl::TimeDelta::Max(),
+                          &dropped_task_count));
+  EXPECT_EQ(0, tasks_run);
+  EXPECT_EQ(5u, dropped_task_count);
+}
+
+TEST(Thread, StopImmediateCutsShortDrain) {
+  Thread thread;
+  EXPECT_TRUE(thread.Run());
+
+  ftl::ManualResetWaitableEvent started;
+  ftl::ManualResetWaitableEvent unblock;
+  thread.TaskRunner()->PostTask([&started, &unblock] {
+    started.Signal();
+    unblock.Wait();
+  });
+  thread.TaskRunner()->PostTask([] {});
+  started.Wait();
+
+  EXPECT_FALSE(thread.Stop(Thread::StopMode::kDrain,
+                           ftl::TimeDelta::FromMilliseconds(10)));
+  unblock.Signal();
+  EXPECT_TRUE(thread.Stop(Thread::StopMode::kImmediate));
+  EXPECT_FALSE(thread.IsRunning());
+}
+
+// Reposts itself forever, so that only |kImmediate| can stop the thread.
+void Repost(ftl::RefPtr<ftl::TaskRunner> task_runner) {
+  task_runner->PostTask([task_runner] { Repost(task_runner); });
+}
+
+TEST(Thread, StopImmediateCutsShortEndlessDrain) {
+  for (int i = 0; i < 100; i++) {
+    Thread thread;
+    EXPECT_TRUE(thread.Run());
+    Repost(thread.TaskRunner());
+
+    // Escalate at varying points of the drain, including before it starts.
+    EXPECT_FALSE(
+        thread.Stop(Thread::StopMode::kDrain,
+                    ftl::TimeDelta::FromMicroseconds(i % 10 * 100)));
+    EXPECT_TRUE(thread.Stop(Thread::StopMode::kImmediate));
+    EXPECT_FALSE(thread.IsRunning());
+  }
+}
+
 }  // namespace
 }  // namespace mtl
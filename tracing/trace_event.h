@@ -0,0 +1,70 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_MTL_TRACING_TRACE_EVENT_H_
+#define LIB_MTL_TRACING_TRACE_EVENT_H_
+
+// Trace instrumentation macros. These compile to nothing unless
+// |MTL_TRACE_EVENTS_ENABLED| is defined, which is controlled by the
+// |mtl_enable_trace_events| build argument.
+//
+// Events are collected in |mtl::tracing::TraceLog::GetInstance()|.
+// |category| and |name| must be string literals.
+//
+//   MTL_TRACE_DURATION(category, name)
+//       Records a complete event spanning the rest of the enclosing scope.
+//
+//   MTL_TRACE_FLOW_BEGIN(category, name, flow_id)
+//   MTL_TRACE_FLOW_END(category, name, flow_id)
+//       Connect two points (typically on different threads) with an arrow.
+//       The flow end is bound to the enclosing duration.
+//
+//   MTL_TRACE_COUNTER(category, name, value)
+//       Records the current value of a counter.
+//
+//   MTL_TRACE_NEXT_FLOW_ID()
+//       Returns a new flow id, or 0 when tracing is compiled out.
+
+#if defined(MTL_TRACE_EVENTS_ENABLED) && MTL_TRACE_EVENTS_ENABLED
+
+#include "lib/mtl/tracing/trace_log.h"
+
+#define MTL_TRACE_INTERNAL_CONCAT2(a, b) a##b
+#define MTL_TRACE_INTERNAL_CONCAT(a, b) MTL_TRACE_INTERNAL_CONCAT2(a, b)
+
+#define MTL_TRACE_DURATION(category, name)          \
+  ::mtl::tracing::ScopedTraceDuration               \
+  MTL_TRACE_INTERNAL_CONCAT(mtl_trace_duration_, __LINE__)(category, name)
+
+#define MTL_TRACE_FLOW_BEGIN(category, name, flow_id) \
+  ::mtl::tracing::TraceLog::GetInstance()->AddFlowBegin(category, name, flow_id)
+
+#define MTL_TRACE_FLOW_END(category, name, flow_id) \
+  ::mtl::tracing::TraceLog::GetInstance()->AddFlowEnd(category, name, flow_id)
+
+#define MTL_TRACE_COUNTER(category, name, value) \
+  ::mtl::tracing::TraceLog::GetInstance()->AddCounter(category, name, value)
+
+#define MTL_TRACE_NEXT_FLOW_ID() \
+  ::mtl::tracing::TraceLog::GetInstance()->NextFlowId()
+
+#else  // MTL_TRACE_EVENTS_ENABLED
+
+#define MTL_TRACE_DURATION(category, name) \
+  do {                                     \
+  } while (false)
+#define MTL_TRACE_FLOW_BEGIN(category, name, flow_id) \
+  do {                                                \
+  } while (false)
+#define MTL_TRACE_FLOW_END(category, name, flow_id) \
+  do {                                              \
+  } while (false)
+#define MTL_TRACE_COUNTER(category, name, value) \
+  do {                                           \
+  } while (false)
+#define MTL_TRACE_NEXT_FLOW_ID() (0u)
+
+#endif  // MTL_TRACE_EVENTS_ENABLED
+
+#endif  // LIB_MTL_TRACING_TRACE_EVENT_H_
@@ -0,0 +1,272 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/tracing/trace_log.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "lib/ftl/logging.h"
+#include "lib/ftl/time/time_point.h"
+#include "lib/mtl/handles/object_info.h"
+
+namespace mtl {
+namespace tracing {
+namespace {
+
+// Identifies the trace log which |t_buffer| belongs to. Ids are never reused
+// so a stale pointer left behind by a destroyed log is never dereferenced.
+thread_local uint64_t t_log_id;
+thread_local TraceBuffer* t_buffer;
+
+std::atomic<uint64_t> g_next_log_id{1u};
+
+void AppendEscaped(std::string* out, const char* str) {
+  for (const char* p = str; *p; p++) {
+    char c = *p;
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escape[8];
+      snprintf(escape, sizeof(escape), "\\u%04x", c);
+      out->append(escape);
+    } else {
+      out->push_back(c);
+    }
+  }
+}
+
+void AppendEvent(std::string* out,
+                 mx_koid_t pid,
+                 mx_koid_t tid,
+                 const TraceEvent& event) {
+  char buf[128];
+  out->append("{\"cat\":\"");
+  AppendEscaped(out, event.category);
+  out->append("\",\"name\":\"");
+  AppendEscaped(out, event.name);
+  snprintf(buf, sizeof(buf),
+           "\",\"ph\":\"%c\",\"pid\":%" PRIu64 ",\"tid\":%" PRIu64
+           ",\"ts\":%.3f",
+           static_cast<char>(event.phase), pid, tid,
+           event.timestamp_ns / 1000.0);
+  out->append(buf);
+
+  switch (event.phase) {
+    case TracePhase::kComplete:
+      snprintf(buf, sizeof(buf), ",\"dur\":%.3f", event.duration_ns / 1000.0);
+      break;
+    case TracePhase::kCounter:
+      snprintf(buf, sizeof(buf), ",\"args\":{\"value\":%" PRIu64 "}",
+               event.value);
+      break;
+    case TracePhase::kFlowBegin:
+      snprintf(buf, sizeof(buf), ",\"id\":%" PRIu64, event.value);
+      break;
+    case TracePhase::kFlowEnd:
+      // Bind to the enclosing slice rather than the next one.
+      snprintf(buf, sizeof(buf), ",\"id\":%" PRIu64 ",\"bp\":\"e\"",
+               event.value);
+      break;
+    case TracePhase::kInstant:
+      snprintf(buf, sizeof(buf), ",\"s\":\"t\"");
+      break;
+  }
+  out->append(buf);
+  out->push_back('}');
+}
+
+}  // namespace
+
+// TraceBuffer -----------------------------------------------------------------
+
+TraceBuffer::TraceBuffer(size_t capacity, mx_koid_t thread_koid)
+    : thread_koid_(thread_koid),
+      mask_(capacity - 1u),
+      slots_(new Slot[capacity]) {
+  FTL_DCHECK(capacity > 0u && (capacity & mask_) == 0u)
+      << "Capacity must be a power of two: " << capacity;
+}
+
+TraceBuffer::~TraceBuffer() {}
+
+void TraceBuffer::Add(const TraceEvent& event) {
+  uint64_t position = write_position_.load(std::memory_order_relaxed);
+  Slot& slot = slots_[position & mask_];
+  slot.sequence.store(position * 2u + 1u, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.category.store(event.category, std::memory_order_relaxed);
+  slot.name.store(event.name, std::memory_order_relaxed);
+  slot.phase.store(event.phase, std::memory_order_relaxed);
+  slot.timestamp_ns.store(event.timestamp_ns, std::memory_order_relaxed);
+  slot.duration_ns.store(event.duration_ns, std::memory_order_relaxed);
+  slot.value.store(event.value, std::memory_order_relaxed);
+  slot.sequence.store(position * 2u + 2u, std::memory_order_release);
+  write_position_.store(position + 1u, std::memory_order_release);
+}
+
+void TraceBuffer::Snapshot(std::vector<TraceEvent>* events) const {
+  FTL_DCHECK(events);
+
+  uint64_t end = write_position_.load(std::memory_order_acquire);
+  uint64_t begin = read_position_.load(std::memory_order_relaxed);
+  if (end - begin > capacity())
+    begin = end - capacity();
+  for (uint64_t position = begin; position < end; position++) {
+    const Slot& slot = slots_[position & mask_];
+    const uint64_t expected = position * 2u + 2u;
+    if (slot.sequence.load(std::memory_order_acquire) != expected)
+      continue;  // overwritten by a newer event
+    TraceEvent event;
+    event.category = slot.category.load(std::memory_order_relaxed);
+    event.name = slot.name.load(std::memory_order_relaxed);
+    event.phase = slot.phase.load(std::memory_order_relaxed);
+    event.timestamp_ns = slot.timestamp_ns.load(std::memory_order_relaxed);
+    event.duration_ns = slot.duration_ns.load(std::memory_order_relaxed);
+    event.value = slot.value.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != expected)
+      continue;  // overwritten while being copied
+    events->push_back(event);
+  }
+}
+
+void TraceBuffer::Clear() {
+  read_position_.store(write_position_.load(std::memory_order_acquire),
+                       std::memory_order_relaxed);
+}
+
+// TraceLog --------------------------------------------------------------------
+
+TraceLog::TraceLog(size_t buffer_capacity)
+    : id_(g_next_log_id.fetch_add(1u, std::memory_order_relaxed)),
+      buffer_capacity_(buffer_capacity) {}
+
+TraceLog::~TraceLog() {}
+
+TraceLog* TraceLog::GetInstance() {
+  // Leaked intentionally so that threads may keep tracing during exit.
+  static TraceLog* instance = new TraceLog();
+  return instance;
+}
+
+void TraceLog::AddEvent(const TraceEvent& event) {
+  GetBufferForCurrentThread()->Add(event);
+}
+
+void TraceLog::AddComplete(const char* category,
+                           const char* name,
+                           int64_t start_ns,
+                           int64_t end_ns) {
+  TraceEvent event;
+  event.category = category;
+  event.name = name;
+  event.phase = TracePhase::kComplete;
+  event.timestamp_ns = start_ns;
+  event.duration_ns = end_ns - start_ns;
+  AddEvent(event);
+}
+
+void TraceLog::AddFlowBegin(const char* category,
+                            const char* name,
+                            uint64_t flow_id) {
+  TraceEvent event;
+  event.category = category;
+  event.name = name;
+  event.phase = TracePhase::kFlowBegin;
+  event.timestamp_ns = Now();
+  event.value = flow_id;
+  AddEvent(event);
+}
+
+void TraceLog::AddFlowEnd(const char* category,
+                          const char* name,
+                          uint64_t flow_id) {
+  TraceEvent event;
+  event.category = category;
+  event.name = name;
+  event.phase = TracePhase::kFlowEnd;
+  event.timestamp_ns = Now();
+  event.value = flow_id;
+  AddEvent(event);
+}
+
+void TraceLog::AddCounter(const char* category,
+                          const char* name,
+                          uint64_t value) {
+  TraceEvent event;
+  event.category = category;
+  event.name = name;
+  event.phase = TracePhase::kCounter;
+  event.timestamp_ns = Now();
+  event.value = value;
+  AddEvent(event);
+}
+
+uint64_t TraceLog::NextFlowId() {
+  return next_flow_id_.fetch_add(1u, std::memory_order_relaxed);
+}
+
+std::string TraceLog::ToJson() const {
+  mx_koid_t pid = GetCurrentProcessKoid();
+  std::vector<TraceEvent> events;
+  std::string json("{\"traceEvents\":[");
+  bool first = true;
+
+  ftl::MutexLocker locker(&mutex_);
+  for (const auto& buffer : buffers_) {
+    events.clear();
+    buffer->Snapshot(&events);
+    for (const auto& event : events) {
+      if (!first)
+        json.push_back(',');
+      first = false;
+      AppendEvent(&json, pid, buffer->thread_koid(), event);
+    }
+  }
+  json.append("],\"displayTimeUnit\":\"ns\"}");
+  return json;
+}
+
+void TraceLog::Clear() {
+  ftl::MutexLocker locker(&mutex_);
+  for (const auto& buffer : buffers_)
+    buffer->Clear();
+}
+
+int64_t TraceLog::Now() {
+  return ftl::TimePoint::Now().ToEpochDelta().ToNanoseconds();
+}
+
+TraceBuffer* TraceLog::GetBufferForCurrentThread() {
+  if (t_log_id == id_)
+    return t_buffer;
+
+  // Buffers are owned by the log rather than by the thread so that events
+  // remain available for dumping after the thread exits. A thread which
+  // switches between logs picks its existing buffer back up.
+  mx_koid_t thread_koid = GetCurrentThreadKoid();
+  TraceBuffer* result = nullptr;
+  {
+    ftl::MutexLocker locker(&mutex_);
+    for (const auto& buffer : buffers_) {
+      if (buffer->thread_koid() == thread_koid) {
+        result = buffer.get();
+        break;
+      }
+    }
+    if (!result) {
+      buffers_.push_back(
+          std::make_unique<TraceBuffer>(buffer_capacity_, thread_koid));
+      result = buffers_.back().get();
+    }
+  }
+  t_log_id = id_;
+  t_buffer = result;
+  return result;
+}
+
+}  // namespace tracing
+}  // namespace mtl
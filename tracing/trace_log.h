@@ -0,0 +1,176 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_MTL_TRACING_TRACE_LOG_H_
+#define LIB_MTL_TRACING_TRACE_LOG_H_
+
+#include <magenta/types.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lib/ftl/ftl_export.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/synchronization/mutex.h"
+#include "lib/ftl/synchronization/thread_annotations.h"
+
+namespace mtl {
+namespace tracing {
+
+// Event phases, using the single-character codes of the Chrome trace event
+// format.
+enum class TracePhase : char {
+  kComplete = 'X',
+  kCounter = 'C',
+  kFlowBegin = 's',
+  kFlowEnd = 'f',
+  kInstant = 'i',
+};
+
+// A single trace event. |category| and |name| must point to strings with
+// static storage duration (typically string literals).
+struct TraceEvent {
+  const char* category = nullptr;
+  const char* name = nullptr;
+  TracePhase phase = TracePhase::kInstant;
+
+  // Monotonic time at which the event occurred, in nanoseconds.
+  int64_t timestamp_ns = 0;
+
+  // Duration of |TracePhase::kComplete| events, in nanoseconds.
+  int64_t duration_ns = 0;
+
+  // Flow id of |TracePhase::kFlowBegin| and |TracePhase::kFlowEnd| events or
+  // value of |TracePhase::kCounter| events.
+  uint64_t value = 0u;
+};
+
+// Fixed-capacity ring buffer of trace events written by a single thread.
+//
+// Writes are lock-free: only the owning thread calls |Add| and publishes
+// events with a release store of the write position. Once the buffer is full,
+// the oldest events are overwritten.
+//
+// |Snapshot| may be called from any thread. Each slot carries a sequence
+// number, seqlock style, so events which are overwritten while the snapshot
+// is taken are skipped rather than copied torn.
+class FTL_EXPORT TraceBuffer {
+ public:
+  // |capacity| must be a power of two.
+  TraceBuffer(size_t capacity, mx_koid_t thread_koid);
+  ~TraceBuffer();
+
+  size_t capacity() const { return mask_ + 1u; }
+  mx_koid_t thread_koid() const { return thread_koid_; }
+
+  // Appends an event. Must only be called from the owning thread.
+  void Add(const TraceEvent& event);
+
+  // Copies the retained events, oldest first, into |events|.
+  void Snapshot(std::vector<TraceEvent>* events) const;
+
+  // Drops all retained events.
+  void Clear();
+
+ private:
+  // The fields of a |TraceEvent|, stored as atomics so that |Snapshot| can
+  // read them while |Add| overwrites them.
+  struct Slot {
+    // Odd while the slot is being written. Otherwise twice the position of
+    // the event it holds plus two, or zero if the slot was never written.
+    std::atomic<uint64_t> sequence{0u};
+    std::atomic<const char*> category{nullptr};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<TracePhase> phase{TracePhase::kInstant};
+    std::atomic<int64_t> timestamp_ns{0};
+    std::atomic<int64_t> duration_ns{0};
+    std::atomic<uint64_t> value{0u};
+  };
+
+  const mx_koid_t thread_koid_;
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> write_position_{0u};
+  std::atomic<uint64_t> read_position_{0u};
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(TraceBuffer);
+};
+
+// Collects trace events from all threads, each into its own |TraceBuffer|,
+// and dumps them in the Chrome trace event JSON format (viewable with
+// chrome://tracing).
+//
+// This object is thread-safe.
+class FTL_EXPORT TraceLog {
+ public:
+  static constexpr size_t kDefaultBufferCapacity = 16 * 1024;
+
+  explicit TraceLog(size_t buffer_capacity = kDefaultBufferCapacity);
+  ~TraceLog();
+
+  // Returns the process-wide trace log used by the MTL_TRACE_* macros.
+  static TraceLog* GetInstance();
+
+  // Records an event in the current thread's buffer.
+  void AddEvent(const TraceEvent& event);
+
+  // Convenience wrappers around |AddEvent| which timestamp the event now.
+  void AddComplete(const char* category,
+                   const char* name,
+                   int64_t start_ns,
+                   int64_t end_ns);
+  void AddFlowBegin(const char* category, const char* name, uint64_t flow_id);
+  void AddFlowEnd(const char* category, const char* name, uint64_t flow_id);
+  void AddCounter(const char* category, const char* name, uint64_t value);
+
+  // Returns a process-unique, non-zero id for connecting flow events.
+  uint64_t NextFlowId();
+
+  // Returns all retained events as a Chrome trace event JSON document.
+  std::string ToJson() const;
+
+  // Drops all retained events from all threads.
+  void Clear();
+
+  // Returns the current monotonic time in nanoseconds.
+  static int64_t Now();
+
+ private:
+  TraceBuffer* GetBufferForCurrentThread();
+
+  const uint64_t id_;
+  const size_t buffer_capacity_;
+  std::atomic<uint64_t> next_flow_id_{1u};
+
+  mutable ftl::Mutex mutex_;
+  std::vector<std::unique_ptr<TraceBuffer>> buffers_ FTL_GUARDED_BY(mutex_);
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(TraceLog);
+};
+
+// Records a |TracePhase::kComplete| event covering its own lifetime.
+class FTL_EXPORT ScopedTraceDuration {
+ public:
+  ScopedTraceDuration(const char* category, const char* name)
+      : category_(category), name_(name), start_ns_(TraceLog::Now()) {}
+
+  ~ScopedTraceDuration() {
+    TraceLog::GetInstance()->AddComplete(category_, name_, start_ns_,
+                                         TraceLog::Now());
+  }
+
+ private:
+  const char* const category_;
+  const char* const name_;
+  const int64_t start_ns_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ScopedTraceDuration);
+};
+
+}  // namespace tracing
+}  // namespace mtl
+
+#endif  // LIB_MTL_TRACING_TRACE_LOG_H_
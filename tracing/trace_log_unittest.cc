@@ -0,0 +1,129 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/tracing/trace_log.h"
+
+#include <atomic>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace mtl {
+namespace tracing {
+namespace {
+
+TraceEvent MakeCounter(uint64_t value) {
+  TraceEvent event;
+  event.category = "test";
+  event.name = "counter";
+  event.phase = TracePhase::kCounter;
+  event.value = value;
+  return event;
+}
+
+TEST(TraceBuffer, RetainsEventsInOrder) {
+  TraceBuffer buffer(4u, 1u);
+  buffer.Add(MakeCounter(1u));
+  buffer.Add(MakeCounter(2u));
+
+  std::vector<TraceEvent> events;
+  buffer.Snapshot(&events);
+  ASSERT_EQ(2u, events.size());
+  EXPECT_EQ(1u, events[0].value);
+  EXPECT_EQ(2u, events[1].value);
+}
+
+TEST(TraceBuffer, OverwritesOldestEvents) {
+  TraceBuffer buffer(4u, 1u);
+  for (uint64_t i = 0; i < 6u; i++)
+    buffer.Add(MakeCounter(i));
+
+  std::vector<TraceEvent> events;
+  buffer.Snapshot(&events);
+  ASSERT_EQ(4u, events.size());
+  EXPECT_EQ(2u, events[0].value);
+  EXPECT_EQ(5u, events[3].value);
+}
+
+TEST(TraceBuffer, Clear) {
+  TraceBuffer buffer(4u, 1u);
+  buffer.Add(MakeCounter(1u));
+  buffer.Clear();
+  buffer.Add(MakeCounter(2u));
+
+  std::vector<TraceEvent> events;
+  buffer.Snapshot(&events);
+  ASSERT_EQ(1u, events.size());
+  EXPECT_EQ(2u, events[0].value);
+}
+
+TEST(TraceBuffer, ConcurrentSnapshotsAreConsistent) {
+  TraceBuffer buffer(64u, 1u);
+  std::atomic<bool> done(false);
+  std::thread writer([&buffer, &done] {
+    for (uint64_t i = 1u; i <= 100000u; i++) {
+      TraceEvent event = MakeCounter(i);
+      event.timestamp_ns = static_cast<int64_t>(i);
+      buffer.Add(event);
+    }
+    done = true;
+  });
+
+  std::vector<TraceEvent> events;
+  while (!done) {
+    events.clear();
+    buffer.Snapshot(&events);
+    uint64_t last = 0u;
+    for (const TraceEvent& event : events) {
+      // A torn event would mix fields written for different positions.
+      EXPECT_EQ(event.value, static_cast<uint64_t>(event.timestamp_ns));
+      EXPECT_LT(last, event.value);
+      last = event.value;
+    }
+  }
+  writer.join();
+}
+
+TEST(TraceLog, FlowIdsAreUnique) {
+  TraceLog log;
+  uint64_t first = log.NextFlowId();
+  EXPECT_NE(0u, first);
+  EXPECT_NE(first, log.NextFlowId());
+}
+
+TEST(TraceLog, EmptyJson) {
+  TraceLog log;
+  EXPECT_EQ("{\"traceEvents\":[],\"displayTimeUnit\":\"ns\"}", log.ToJson());
+}
+
+TEST(TraceLog, JsonContainsEventsFromAllThreads) {
+  TraceLog log;
+  log.AddComplete("test", "main", 1000, 3000);
+  std::thread thread([&log] {
+    log.AddFlowBegin("test", "flow", 7u);
+    log.AddCounter("test", "bytes", 42u);
+  });
+  thread.join();
+
+  std::string json = log.ToJson();
+  EXPECT_NE(std::string::npos,
+            json.find("\"name\":\"main\",\"ph\":\"X\""));
+  EXPECT_NE(std::string::npos, json.find("\"ts\":1.000,\"dur\":2.000"));
+  EXPECT_NE(std::string::npos, json.find("\"ph\":\"s\""));
+  EXPECT_NE(std::string::npos, json.find("\"id\":7"));
+  EXPECT_NE(std::string::npos, json.find("\"args\":{\"value\":42}"));
+
+  log.Clear();
+  EXPECT_EQ("{\"traceEvents\":[],\"displayTimeUnit\":\"ns\"}", log.ToJson());
+}
+
+TEST(TraceLog, EscapesNames) {
+  TraceLog log;
+  log.AddCounter("test", "quote\"name", 1u);
+  EXPECT_NE(std::string::npos, log.ToJson().find("quote\\\"name"));
+}
+
+}  // namespace
+}  // namespace tracing
+}  // namespace mtl
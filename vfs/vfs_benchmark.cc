@@ -0,0 +1,99 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/vfs/vfs_dispatcher.h"
+
+#include <mx/channel.h>
+#include <mxio/remoteio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "lib/mtl/tasks/message_loop.h"
+#include "lib/mtl/test/benchmark.h"
+
+namespace mtl {
+namespace {
+
+using benchmark::State;
+
+constexpr uint32_t kReadSize = 64u;
+constexpr int kPipelineDepth = 64;
+
+// Answers every request as a small read.
+mx_status_t ServeSmallRead(mxrio_msg_t* msg, void* cookie) {
+  if (msg->op == MXRIO_CLOSE)
+    return MX_OK;
+  uint32_t size = std::min(static_cast<uint32_t>(msg->arg), kReadSize);
+  memset(msg->data, 'x', size);
+  msg->datalen = size;
+  return static_cast<mx_status_t>(size);
+}
+
+// A client pipelines |kPipelineDepth| small reads, then collects the
+// replies. |range| is the number of messages handled per wakeup.
+void SmallReads(State* state) {
+  MessageLoop loop;
+  VFSDispatcher dispatcher(&loop);
+  dispatcher.set_max_messages_per_wakeup(state->range());
+
+  mx::channel client, server;
+  if (mx::channel::create(0u, &client, &server) != MX_OK) {
+    state->SkipWithError("Failed to create channel");
+    return;
+  }
+  dispatcher.AddVFSHandler(std::move(server), &ServeSmallRead, nullptr);
+
+  mxrio_msg_t request;
+  memset(&request, 0, MXRIO_HDR_SZ);
+  request.op = MXRIO_READ;
+  request.arg = kReadSize;
+  mxrio_msg_t reply;
+  while (state->KeepRunning()) {
+    for (int i = 0; i < kPipelineDepth; i++) {
+      request.txid = i;
+      client.write(0u, &request, MXRIO_HDR_SZ, nullptr, 0u);
+    }
+    loop.RunUntilIdle();
+    for (int i = 0; i < kPipelineDepth; i++) {
+      uint32_t actual;
+      if (client.read(0u, &reply, sizeof(reply), &actual, nullptr, 0u,
+                      nullptr) != MX_OK ||
+          reply.datalen != kReadSize) {
+        state->SkipWithError("Missing reply");
+        return;
+      }
+    }
+  }
+  int64_t reads = state->iterations() * kPipelineDepth;
+  state->SetItemsProcessed(reads);
+  state->SetBytesProcessed(reads * kReadSize);
+}
+MTL_BENCHMARK_RANGES(SmallReads, 1, 4, 16, 64);
+
+// Opens a channel and has the client close it again, as when a file is
+// opened and closed. |range| is the number of handlers kept for reuse.
+void OpenCloseChurn(State* state) {
+  MessageLoop loop;
+  VFSDispatcher dispatcher(&loop);
+  dispatcher.set_max_pooled_handlers(state->range());
+
+  while (state->KeepRunning()) {
+    mx::channel client, server;
+    if (mx::channel::create(0u, &client, &server) != MX_OK) {
+      state->SkipWithError("Failed to create channel");
+      return;
+    }
+    dispatcher.AddVFSHandler(std::move(server), &ServeSmallRead, nullptr);
+    client.reset();
+    loop.RunUntilIdle();
+  }
+  if (dispatcher.handler_count())
+    state->SkipWithError("Handlers were not stopped");
+  state->SetItemsProcessed(state->iterations());
+}
+MTL_BENCHMARK_RANGES(OpenCloseChurn, 0, 64);
+
+}  // namespace
+}  // namespace mtl
@@ -6,29 +6,148 @@
 
 #include <mxio/remoteio.h>
 
+#include "lib/ftl/functional/make_copyable.h"
+#include "lib/ftl/strings/string_printf.h"
+#include "lib/mtl/threading/thread.h"
 #include "lib/mtl/vfs/vfs_handler.h"
 
 namespace mtl {
 
-VFSDispatcher::VFSDispatcher() = default;
+VFSDispatcher::VFSDispatcher() : VFSDispatcher(nullptr, 0u) {}
+
+VFSDispatcher::VFSDispatcher(MessageLoop* message_loop)
+    : VFSDispatcher(message_loop, 0u) {}
+
+VFSDispatcher::VFSDispatcher(MessageLoop* message_loop, size_t thread_count)
+    : message_loop_(message_loop), handlers_(thread_count ? thread_count : 1u) {
+  for (size_t i = 0; i < thread_count; i++) {
+    ThreadOptions options;
+    options.name = ftl::StringPrintf("vfs dispatcher %zu", i);
+    auto thread = std::make_unique<Thread>();
+    FTL_CHECK(thread->Run(options));
+    threads_.push_back(std::move(thread));
+  }
+}
+
+std::unique_ptr<VFSDispatcher> VFSDispatcher::CreateMultiThreaded(
+    size_t thread_count) {
+  FTL_DCHECK(thread_count > 0u);
+  return std::unique_ptr<VFSDispatcher>(
+      new VFSDispatcher(nullptr, thread_count));
+}
 
 VFSDispatcher::~VFSDispatcher() {
-  for (auto handler : std::move(handlers_))
-    delete handler;
+  if (threads_.empty()) {
+    DeleteHandlers(0u);
+  } else {
+    // Handlers must be destroyed on their own threads. Draining also runs any
+    // |VFSHandler::Start| tasks which are still queued ahead of the deletion.
+    for (size_t i = 0; i < threads_.size(); i++)
+      threads_[i]->TaskRunner()->PostTask([this, i] { DeleteHandlers(i); });
+    for (auto& thread : threads_)
+      thread->Stop(Thread::StopMode::kDrain);
+  }
+
+  // Pooled handlers are not registered with any loop.
+  set_max_pooled_handlers(0u);
 }
 
 mx_status_t VFSDispatcher::AddVFSHandler(mx::channel channel,
                                          fs::vfs_dispatcher_cb_t callback,
                                          void* iostate) {
-  VFSHandler* handler = new VFSHandler(this);
-  handler->Start(std::move(channel), callback, iostate);
-  handlers_.insert(handler);
+  VFSHandler* handler = AcquireHandler();
+
+  // All messages on the channel are handled by the same thread, which keeps
+  // them in order.
+  size_t thread_index = 0u;
+  {
+    ftl::MutexLocker locker(&mutex_);
+    if (!threads_.empty()) {
+      thread_index = next_thread_;
+      next_thread_ = (next_thread_ + 1u) % threads_.size();
+    }
+    handler->thread_index_ = thread_index;
+    handlers_[thread_index].push_front(handler);
+    handler_count_++;
+  }
+
+  if (threads_.empty()) {
+    handler->Start(std::move(channel), callback, iostate,
+                   message_loop_ ? message_loop_ : MessageLoop::GetCurrent());
+    return MX_OK;
+  }
+
+  threads_[thread_index]->TaskRunner()->PostTask(ftl::MakeCopyable(
+      [ handler, channel = std::move(channel), callback, iostate ]() mutable {
+        handler->Start(std::move(channel), callback, iostate,
+                       MessageLoop::GetCurrent());
+      }));
   return MX_OK;
 }
 
 void VFSDispatcher::Stop(VFSHandler* handler) {
-  handlers_.erase(handler);
+  // Closes the channel outside the lock.
+  handler->Reset();
+
+  {
+    ftl::MutexLocker locker(&mutex_);
+    handlers_[handler->thread_index_].erase(*handler);
+    handler_count_--;
+    if (free_handler_count_ < max_pooled_handlers_) {
+      free_handlers_.push_front(handler);
+      free_handler_count_++;
+      return;
+    }
+  }
   delete handler;
 }
 
+size_t VFSDispatcher::handler_count() const {
+  ftl::MutexLocker locker(&mutex_);
+  return handler_count_;
+}
+
+void VFSDispatcher::set_max_pooled_handlers(size_t count) {
+  HandlerList excess;
+  {
+    ftl::MutexLocker locker(&mutex_);
+    max_pooled_handlers_ = count;
+    while (free_handler_count_ > max_pooled_handlers_) {
+      excess.push_front(free_handlers_.pop_front());
+      free_handler_count_--;
+    }
+  }
+  while (!excess.is_empty())
+    delete excess.pop_front();
+}
+
+size_t VFSDispatcher::pooled_handler_count() const {
+  ftl::MutexLocker locker(&mutex_);
+  return free_handler_count_;
+}
+
+VFSHandler* VFSDispatcher::AcquireHandler() {
+  {
+    ftl::MutexLocker locker(&mutex_);
+    if (free_handler_count_) {
+      free_handler_count_--;
+      return free_handlers_.pop_front();
+    }
+  }
+  return new VFSHandler(this);
+}
+
+void VFSDispatcher::DeleteHandlers(size_t thread_index) {
+  HandlerList handlers;
+  {
+    ftl::MutexLocker locker(&mutex_);
+    while (!handlers_[thread_index].is_empty()) {
+      handlers.push_front(handlers_[thread_index].pop_front());
+      handler_count_--;
+    }
+  }
+  while (!handlers.is_empty())
+    delete handlers.pop_front();
+}
+
 }  // namespace mtl
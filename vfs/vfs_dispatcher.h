@@ -7,18 +7,40 @@
 
 #include <fs/dispatcher.h>
 
+#include <atomic>
 #include <memory>
-#include <set>
+#include <vector>
 
 #include "lib/ftl/ftl_export.h"
+#include "lib/ftl/logging.h"
 #include "lib/ftl/macros.h"
+#include "lib/ftl/synchronization/mutex.h"
+#include "lib/ftl/synchronization/thread_annotations.h"
 #include "lib/mtl/vfs/vfs_handler.h"
 
 namespace mtl {
+class Thread;
 
 class FTL_EXPORT VFSDispatcher : public fs::Dispatcher {
  public:
+  static constexpr size_t kDefaultMaxMessagesPerWakeup = 16u;
+  static constexpr size_t kDefaultMaxPooledHandlers = 64u;
+
+  // Serves channels on the message loop of the thread which adds them.
   VFSDispatcher();
+
+  // Serves channels on |message_loop|. Channels must be added on the loop's
+  // thread, and the loop must outlive the dispatcher.
+  explicit VFSDispatcher(MessageLoop* message_loop);
+
+  // Creates a dispatcher which owns |thread_count| threads and serves each
+  // channel on one of them, in turn. Messages on a given channel are still
+  // handled in order, but different channels are served concurrently, so the
+  // file system's callbacks must be thread-safe. Channels may be added from
+  // any thread.
+  static std::unique_ptr<VFSDispatcher> CreateMultiThreaded(
+      size_t thread_count);
+
   ~VFSDispatcher() override;
 
   mx_status_t AddVFSHandler(mx::channel channel,
@@ -26,8 +48,56 @@ class FTL_EXPORT VFSDispatcher : public fs::Dispatcher {
                             void* iostate) final;
   void Stop(VFSHandler* handler);
 
+  // Returns the number of channels being served.
+  size_t handler_count() const;
+
+  // The number of messages a channel may handle each time it becomes
+  // readable before yielding to other work on its loop. Larger values save
+  // wakeups when clients pipeline requests; smaller ones keep a busy channel
+  // from delaying others. Must be at least one. May be called from any
+  // thread.
+  void set_max_messages_per_wakeup(size_t count) {
+    FTL_DCHECK(count > 0u);
+    max_messages_per_wakeup_.store(count, std::memory_order_relaxed);
+  }
+  size_t max_messages_per_wakeup() const {
+    return max_messages_per_wakeup_.load(std::memory_order_relaxed);
+  }
+
+  // The number of handlers of closed channels which are kept for reuse, so
+  // that workloads which open and close files at a high rate do not allocate
+  // a handler per file.
+  void set_max_pooled_handlers(size_t count);
+
+  // Returns the number of handlers currently kept for reuse.
+  size_t pooled_handler_count() const;
+
  private:
-  std::set<VFSHandler*> handlers_;
+  VFSDispatcher(MessageLoop* message_loop, size_t thread_count);
+
+  using HandlerList = mxtl::DoublyLinkedList<VFSHandler*>;
+
+  // Destroys the handlers served by the thread at |thread_index|. Must run
+  // on that thread.
+  void DeleteHandlers(size_t thread_index);
+
+  // Returns a pooled handler or a new one.
+  VFSHandler* AcquireHandler();
+
+  MessageLoop* const message_loop_;
+  std::vector<std::unique_ptr<Thread>> threads_;
+  std::atomic<size_t> max_messages_per_wakeup_{kDefaultMaxMessagesPerWakeup};
+
+  mutable ftl::Mutex mutex_;
+  // The active handlers of each thread. Single-threaded dispatchers have one
+  // list.
+  std::vector<HandlerList> handlers_ FTL_GUARDED_BY(mutex_);
+  size_t handler_count_ FTL_GUARDED_BY(mutex_) = 0u;
+  HandlerList free_handlers_ FTL_GUARDED_BY(mutex_);
+  size_t free_handler_count_ FTL_GUARDED_BY(mutex_) = 0u;
+  size_t max_pooled_handlers_ FTL_GUARDED_BY(mutex_) =
+      kDefaultMaxPooledHandlers;
+  size_t next_thread_ FTL_GUARDED_BY(mutex_) = 0u;
 
   FTL_DISALLOW_COPY_AND_ASSIGN(VFSDispatcher);
 };
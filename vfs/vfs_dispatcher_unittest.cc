@@ -0,0 +1,294 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/vfs/vfs_dispatcher.h"
+
+#include <mx/channel.h>
+#include <mxio/remoteio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lib/ftl/synchronization/mutex.h"
+#include "lib/ftl/synchronization/thread_annotations.h"
+#include "lib/ftl/time/time_delta.h"
+#include "lib/ftl/time/time_point.h"
+#include "lib/mtl/tasks/message_loop.h"
+
+namespace mtl {
+namespace {
+
+// What the server side of one channel has seen.
+struct ServerState {
+  ftl::Mutex mutex;
+  std::vector<mx_txid_t> txids FTL_GUARDED_BY(mutex);
+  std::vector<std::thread::id> threads FTL_GUARDED_BY(mutex);
+  int close_count FTL_GUARDED_BY(mutex) = 0;
+};
+
+// Records each request in the |ServerState| passed as |cookie| and replies
+// with no data.
+mx_status_t Serve(mxrio_msg_t* msg, void* cookie) {
+  ServerState* state = static_cast<ServerState*>(cookie);
+  ftl::MutexLocker locker(&state->mutex);
+  if (msg->op == MXRIO_CLOSE) {
+    state->close_count++;
+    return MX_OK;
+  }
+  state->txids.push_back(msg->txid);
+  state->threads.push_back(std::this_thread::get_id());
+  msg->datalen = 0u;
+  return MX_OK;
+}
+
+void SendRequest(const mx::channel& client, mx_txid_t txid) {
+  mxrio_msg_t request;
+  memset(&request, 0, MXRIO_HDR_SZ);
+  request.op = MXRIO_READ;
+  request.txid = txid;
+  EXPECT_EQ(MX_OK, client.write(0u, &request, MXRIO_HDR_SZ, nullptr, 0u));
+}
+
+// Waits for the next reply and returns its transaction id, or -1 if the
+// channel was closed.
+int64_t ReadReply(const mx::channel& client) {
+  mx_signals_t pending = 0u;
+  client.wait_one(MX_CHANNEL_READABLE | MX_CHANNEL_PEER_CLOSED,
+                  MX_TIME_INFINITE, &pending);
+  mxrio_msg_t reply;
+  uint32_t actual = 0u;
+  if (client.read(0u, &reply, sizeof(reply), &actual, nullptr, 0u, nullptr) !=
+      MX_OK)
+    return -1;
+  return reply.txid;
+}
+
+// Waits up to a few seconds for the dispatcher's threads to stop every
+// handler.
+bool WaitForNoHandlers(const VFSDispatcher& dispatcher) {
+  ftl::TimePoint deadline =
+      ftl::TimePoint::Now() + ftl::TimeDelta::FromSeconds(5);
+  while (dispatcher.handler_count()) {
+    if (ftl::TimePoint::Now() > deadline)
+      return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+TEST(VFSDispatcher, MultiThreadedKeepsChannelsInOrder) {
+  constexpr size_t kChannelCount = 6u;
+  constexpr mx_txid_t kRequestCount = 200u;
+  auto dispatcher = VFSDispatcher::CreateMultiThreaded(3u);
+
+  ServerState states[kChannelCount];
+  std::vector<std::thread> clients;
+  for (size_t i = 0; i < kChannelCount; i++) {
+    mx::channel client, server;
+    ASSERT_EQ(MX_OK, mx::channel::create(0u, &client, &server));
+    EXPECT_EQ(MX_OK,
+              dispatcher->AddVFSHandler(std::move(server), &Serve, &states[i]));
+    clients.emplace_back([client = std::move(client)] {
+      for (mx_txid_t txid = 0; txid < kRequestCount; txid++)
+        SendRequest(client, txid);
+      for (mx_txid_t txid = 0; txid < kRequestCount; txid++)
+        EXPECT_EQ(static_cast<int64_t>(txid), ReadReply(client));
+    });
+  }
+  for (auto& client : clients)
+    client.join();
+
+  for (ServerState& state : states) {
+    ftl::MutexLocker locker(&state.mutex);
+    ASSERT_EQ(kRequestCount, state.txids.size());
+    for (mx_txid_t txid = 0; txid < kRequestCount; txid++)
+      EXPECT_EQ(txid, state.txids[txid]);
+    // Each channel is served by a single thread.
+    for (const auto& thread : state.threads)
+      EXPECT_EQ(state.threads[0], thread);
+  }
+}
+
+TEST(VFSDispatcher, HandlerCountAfterClientsClose) {
+  MessageLoop loop;
+  VFSDispatcher dispatcher(&loop);
+
+  ServerState states[2];
+  mx::channel clients[2];
+  for (size_t i = 0; i < 2u; i++) {
+    mx::channel server;
+    ASSERT_EQ(MX_OK, mx::channel::create(0u, &clients[i], &server));
+    dispatcher.AddVFSHandler(std::move(server), &Serve, &states[i]);
+  }
+  EXPECT_EQ(2u, dispatcher.handler_count());
+
+  clients[0].reset();
+  loop.RunUntilIdle();
+  EXPECT_EQ(1u, dispatcher.handler_count());
+
+  clients[1].reset();
+  loop.RunUntilIdle();
+  EXPECT_EQ(0u, dispatcher.handler_count());
+
+  for (ServerState& state : states) {
+    ftl::MutexLocker locker(&state.mutex);
+    EXPECT_EQ(1, state.close_count);
+  }
+}
+
+TEST(VFSDispatcher, MultiThreadedHandlerCountAfterClientsClose) {
+  constexpr size_t kChannelCount = 4u;
+  auto dispatcher = VFSDispatcher::CreateMultiThreaded(2u);
+
+  ServerState states[kChannelCount];
+  mx::channel clients[kChannelCount];
+  for (size_t i = 0; i < kChannelCount; i++) {
+    mx::channel server;
+    ASSERT_EQ(MX_OK, mx::channel::create(0u, &clients[i], &server));
+    dispatcher->AddVFSHandler(std::move(server), &Serve, &states[i]);
+  }
+  EXPECT_EQ(kChannelCount, dispatcher->handler_count());
+
+  for (mx::channel& client : clients)
+    client.reset();
+  EXPECT_TRUE(WaitForNoHandlers(*dispatcher));
+
+  for (ServerState& state : states) {
+    ftl::MutexLocker locker(&state.mutex);
+    EXPECT_EQ(1, state.close_count);
+  }
+}
+
+TEST(VFSDispatcher, DestroyWithOpenChannels) {
+  constexpr size_t kChannelCount = 4u;
+  auto dispatcher = VFSDispatcher::CreateMultiThreaded(2u);
+
+  ServerState states[kChannelCount];
+  mx::channel clients[kChannelCount];
+  for (size_t i = 0; i < kChannelCount; i++) {
+    mx::channel server;
+    ASSERT_EQ(MX_OK, mx::channel::create(0u, &clients[i], &server));
+    dispatcher->AddVFSHandler(std::move(server), &Serve, &states[i]);
+  }
+  // Some channels are being served. The others may not have started yet.
+  SendRequest(clients[0], 1u);
+  EXPECT_EQ(1, ReadReply(clients[0]));
+  SendRequest(clients[1], 2u);
+  EXPECT_EQ(2, ReadReply(clients[1]));
+
+  dispatcher.reset();
+
+  for (size_t i = 0; i < kChannelCount; i++) {
+    {
+      ftl::MutexLocker locker(&states[i].mutex);
+      EXPECT_EQ(1, states[i].close_count);
+    }
+    mx_signals_t pending = 0u;
+    EXPECT_EQ(MX_OK, clients[i].wait_one(MX_CHANNEL_PEER_CLOSED, 0u, &pending));
+    EXPECT_TRUE(pending & MX_CHANNEL_PEER_CLOSED);
+  }
+}
+
+// Appends |id| to |log| for each request.
+struct LoggingState {
+  std::vector<int>* log;
+  int id;
+};
+
+mx_status_t ServeLogged(mxrio_msg_t* msg, void* cookie) {
+  LoggingState* state = static_cast<LoggingState*>(cookie);
+  if (msg->op != MXRIO_CLOSE)
+    state->log->push_back(state->id);
+  msg->datalen = 0u;
+  return MX_OK;
+}
+
+TEST(VFSDispatcher, BusyChannelsInterleave) {
+  constexpr size_t kBudget = 2u;
+  constexpr mx_txid_t kRequestCount = 3u * kBudget;
+  MessageLoop loop;
+  VFSDispatcher dispatcher(&loop);
+  dispatcher.set_max_messages_per_wakeup(kBudget);
+
+  std::vector<int> log;
+  LoggingState states[2] = {{&log, 0}, {&log, 1}};
+  mx::channel clients[2];
+  for (size_t i = 0; i < 2u; i++) {
+    mx::channel server;
+    ASSERT_EQ(MX_OK, mx::channel::create(0u, &clients[i], &server));
+    dispatcher.AddVFSHandler(std::move(server), &ServeLogged, &states[i]);
+    for (mx_txid_t txid = 0; txid < kRequestCount; txid++)
+      SendRequest(clients[i], txid);
+  }
+  loop.RunUntilIdle();
+
+  ASSERT_EQ(2u * kRequestCount, log.size());
+  // Neither channel has all of its messages handled before the other's
+  // first one.
+  for (int id = 0; id < 2; id++) {
+    auto first_other = std::find(log.begin(), log.end(), 1 - id);
+    auto last_own = std::find(log.rbegin(), log.rend(), id);
+    EXPECT_LT(first_other - log.begin(), log.rend() - last_own - 1);
+  }
+}
+
+TEST(VFSDispatcher, PooledHandlerServesNewChannel) {
+  MessageLoop loop;
+  VFSDispatcher dispatcher(&loop);
+  dispatcher.set_max_pooled_handlers(1u);
+
+  ServerState first;
+  mx::channel first_client, server;
+  ASSERT_EQ(MX_OK, mx::channel::create(0u, &first_client, &server));
+  dispatcher.AddVFSHandler(std::move(server), &Serve, &first);
+  SendRequest(first_client, 1u);
+  loop.RunUntilIdle();
+  EXPECT_EQ(1, ReadReply(first_client));
+
+  first_client.reset();
+  loop.RunUntilIdle();
+  EXPECT_EQ(0u, dispatcher.handler_count());
+  EXPECT_EQ(1u, dispatcher.pooled_handler_count());
+
+  // The pooled handler is reused, and serves the new channel with the new
+  // callback state.
+  ServerState second;
+  mx::channel second_client;
+  ASSERT_EQ(MX_OK, mx::channel::create(0u, &second_client, &server));
+  dispatcher.AddVFSHandler(std::move(server), &Serve, &second);
+  EXPECT_EQ(1u, dispatcher.handler_count());
+  EXPECT_EQ(0u, dispatcher.pooled_handler_count());
+  SendRequest(second_client, 2u);
+  loop.RunUntilIdle();
+  EXPECT_EQ(2, ReadReply(second_client));
+
+  {
+    ftl::MutexLocker locker(&first.mutex);
+    EXPECT_EQ(std::vector<mx_txid_t>{1u}, first.txids);
+    EXPECT_EQ(1, first.close_count);
+  }
+  {
+    ftl::MutexLocker locker(&second.mutex);
+    EXPECT_EQ(std::vector<mx_txid_t>{2u}, second.txids);
+    EXPECT_EQ(0, second.close_count);
+  }
+
+  second_client.reset();
+  loop.RunUntilIdle();
+  EXPECT_EQ(1u, dispatcher.pooled_handler_count());
+  {
+    ftl::MutexLocker locker(&second.mutex);
+    EXPECT_EQ(1, second.close_count);
+  }
+
+  dispatcher.set_max_pooled_handlers(0u);
+  EXPECT_EQ(0u, dispatcher.pooled_handler_count());
+}
+
+}  // namespace
+}  // namespace mtl
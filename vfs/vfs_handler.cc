@@ -6,18 +6,22 @@
 
 #include <mxio/remoteio.h>
 
+#include "lib/mtl/tracing/trace_event.h"
 #include "lib/mtl/vfs/vfs_dispatcher.h"
 
 namespace mtl {
 
 VFSHandler::VFSHandler(VFSDispatcher* dispatcher)
-    : dispatcher_(dispatcher), key_(0), iostate_(nullptr) {
+    : dispatcher_(dispatcher),
+      message_loop_(nullptr),
+      key_(0),
+      iostate_(nullptr) {
   FTL_DCHECK(dispatcher_);
 }
 
 VFSHandler::~VFSHandler() {
   if (key_) {
-    mtl::MessageLoop::GetCurrent()->RemoveHandler(key_);
+    message_loop_->RemoveHandler(key_);
     key_ = 0;
     mxrio_handler(MX_HANDLE_INVALID, (void*)callback_, iostate_);
   }
@@ -26,23 +30,51 @@ VFSHandler::~VFSHandler() {
 void VFSHandler::Start(mx::channel channel,
                        fs::vfs_dispatcher_cb_t callback,
                        void* iostate) {
+  Start(std::move(channel), callback, iostate, MessageLoop::GetCurrent());
+}
+
+void VFSHandler::Start(mx::channel channel,
+                       fs::vfs_dispatcher_cb_t callback,
+                       void* iostate,
+                       MessageLoop* message_loop) {
   FTL_DCHECK(!channel_);
+  FTL_DCHECK(message_loop);
+  FTL_DCHECK(message_loop == MessageLoop::GetCurrent());
   channel_ = std::move(channel);
   callback_ = callback;
   iostate_ = iostate;
-  key_ = mtl::MessageLoop::GetCurrent()->AddHandler(
+  message_loop_ = message_loop;
+  key_ = message_loop_->AddHandler(
       this, channel_.get(), MX_CHANNEL_READABLE | MX_CHANNEL_PEER_CLOSED);
 }
 
+void VFSHandler::Reset() {
+  FTL_DCHECK(!key_);
+  message_loop_ = nullptr;
+  channel_.reset();
+  callback_ = nullptr;
+  iostate_ = nullptr;
+}
+
 void VFSHandler::OnHandleReady(mx_handle_t handle,
                                mx_signals_t pending,
                                uint64_t count) {
   if (pending & MX_CHANNEL_READABLE) {
-    mx_status_t status =
-        mxrio_handler(channel_.get(), (void*)callback_, iostate_);
-    if (status == MX_OK)
+    MTL_TRACE_DURATION("mtl", "VFSHandler::HandleMessages");
+    // Handle queued messages without going back to the loop for each one,
+    // but only up to the budget so that other handlers still get their turn.
+    const size_t budget = dispatcher_->max_messages_per_wakeup();
+    for (size_t i = 0; i < budget; i++) {
+      mx_status_t status =
+          mxrio_handler(channel_.get(), (void*)callback_, iostate_);
+      if (status == MX_OK)
+        continue;
+      // The channel has been drained.
+      if (status == MX_ERR_SHOULD_WAIT)
+        return;
+      Stop(status < 0);
       return;
-    Stop(status < 0);
+    }
   } else {
     FTL_DCHECK(pending & MX_CHANNEL_PEER_CLOSED);
     Stop(true);
@@ -56,12 +88,13 @@ void VFSHandler::OnHandleError(mx_handle_t handle, mx_status_t error) {
 
 void VFSHandler::Stop(bool needs_close) {
   FTL_DCHECK(key_);
-  mtl::MessageLoop::GetCurrent()->RemoveHandler(key_);
+  message_loop_->RemoveHandler(key_);
   key_ = 0;
   if (needs_close)
     mxrio_handler(MX_HANDLE_INVALID, (void*)callback_, iostate_);
   dispatcher_->Stop(this);
-  // We're deleted now.
+  // The dispatcher has either deleted this handler or reset it for reuse, so
+  // no members may be touched now.
 }
 
 }  // namespace mtl
@@ -7,6 +7,7 @@
 
 #include <fs/dispatcher.h>
 #include <mx/channel.h>
+#include <mxtl/intrusive_double_list.h>
 
 #include "lib/ftl/ftl_export.h"
 #include "lib/mtl/tasks/message_loop.h"
@@ -15,16 +16,31 @@
 namespace mtl {
 class VFSDispatcher;
 
-class FTL_EXPORT VFSHandler : public MessageLoopHandler {
+// Serves one remoteio channel. Handlers are owned by their |VFSDispatcher|,
+// which keeps them on intrusive lists and reuses them once their channel
+// closes.
+class FTL_EXPORT VFSHandler
+    : public MessageLoopHandler,
+      public mxtl::DoublyLinkedListable<VFSHandler*> {
  public:
   explicit VFSHandler(VFSDispatcher* dispatcher);
   ~VFSHandler() override;
 
+  // Starts serving |channel| on the current thread's message loop.
   void Start(mx::channel channel,
              fs::vfs_dispatcher_cb_t callback,
              void* iostate);
 
+  // Starts serving |channel| on |message_loop|, which must belong to the
+  // current thread and outlive the handler.
+  void Start(mx::channel channel,
+             fs::vfs_dispatcher_cb_t callback,
+             void* iostate,
+             MessageLoop* message_loop);
+
  private:
+  friend class VFSDispatcher;
+
   // |MessageLoopHandler| implementation:
   void OnHandleReady(mx_handle_t handle,
                      mx_signals_t pending,
@@ -33,12 +49,20 @@ class FTL_EXPORT VFSHandler : public MessageLoopHandler {
 
   void Stop(bool needs_close);
 
+  // Returns a stopped handler to its initial state so that it can be
+  // started again.
+  void Reset();
+
   VFSDispatcher* dispatcher_;
+  MessageLoop* message_loop_;
   MessageLoop::HandlerKey key_;
   mx::channel channel_;
   fs::vfs_dispatcher_cb_t callback_;
   void* iostate_;
 
+  // The dispatcher thread serving this handler. Owned by the dispatcher.
+  size_t thread_index_ = 0u;
+
   FTL_DISALLOW_COPY_AND_ASSIGN(VFSHandler);
 };
 
@@ -4,25 +4,193 @@
 
 #include "lib/mtl/vmo/file.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <mxio/io.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "lib/ftl/functional/make_copyable.h"
 #include "lib/ftl/logging.h"
+#include "lib/mtl/vmo/vmo_buffer.h"
 
 namespace mtl {
+namespace {
 
-bool VmoFromFd(ftl::UniqueFD fd, mx::vmo* handle_ptr) {
-  FTL_CHECK(handle_ptr);
-
+bool GetFileVmo(int fd, mx::vmo* handle_ptr) {
   mx_handle_t result = MX_HANDLE_INVALID;
-  mx_status_t status = mxio_get_vmo(fd.get(), &result);
+  mx_status_t status = mxio_get_vmo(fd, &result);
   if (status != MX_OK)
     return false;
   handle_ptr->reset(result);
   return true;
 }
 
+size_t RoundUp(size_t value, size_t multiple) {
+  return (value + multiple - 1u) / multiple * multiple;
+}
+
+// Reads a file into a |VmoBuffer| one chunk at a time.
+class FileReader {
+ public:
+  FileReader(ftl::UniqueFD fd, const VmoFromFdOptions& options)
+      : fd_(std::move(fd)), chunk_size_(options.chunk_size) {
+    FTL_DCHECK(chunk_size_ > 0u);
+    readahead_ =
+        RoundUp(std::max(options.readahead, chunk_size_), chunk_size_);
+
+    // When the size is known, reserve it all up front so the VMO is never
+    // remapped. Leave room for one more read to observe the end of the file.
+    struct stat st;
+    if (fstat(fd_.get(), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+      buffer_.ReserveExact(static_cast<size_t>(st.st_size) + 1u);
+  }
+
+  enum class Result { kMore, kDone, kError };
+
+  // Reads the next chunk.
+  Result ReadChunk() {
+    if (buffer_.capacity() == buffer_.size() &&
+        !buffer_.ReserveExact(RoundUp(buffer_.size(), chunk_size_) +
+                              readahead_))
+      return Result::kError;
+
+    // Stop at the next chunk boundary so that reads stay aligned after a
+    // short one.
+    size_t length = std::min(chunk_size_ - buffer_.size() % chunk_size_,
+                             buffer_.capacity() - buffer_.size());
+    ssize_t count;
+    do {
+      count = read(fd_.get(), buffer_.data() + buffer_.size(), length);
+    } while (count < 0 && errno == EINTR);
+    if (count < 0) {
+      FTL_LOG(WARNING) << "Failed to read file: errno=" << errno;
+      return Result::kError;
+    }
+    if (count == 0)
+      return Result::kDone;
+    buffer_.Commit(count);
+    return Result::kMore;
+  }
+
+  bool Finish(mx::vmo* handle_ptr) { return buffer_.Release(handle_ptr); }
+
+ private:
+  ftl::UniqueFD fd_;
+  const size_t chunk_size_;
+  size_t readahead_;
+  VmoBuffer buffer_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(FileReader);
+};
+
+// Reads a file on a task runner, one chunk per task. Each task owns the
+// reader, so if the task runner drops one, the reader reports failure when it
+// is destroyed.
+class AsyncFileReader {
+ public:
+  AsyncFileReader(ftl::UniqueFD fd,
+                  const VmoFromFdOptions& options,
+                  const std::function<void(bool, mx::vmo)>& callback)
+      : reader_(std::move(fd), options), callback_(callback) {}
+
+  ~AsyncFileReader() {
+    if (callback_)
+      SendCallback(false, mx::vmo());
+  }
+
+  static void ReadChunk(std::unique_ptr<AsyncFileReader> self,
+                        ftl::RefPtr<ftl::TaskRunner> task_runner) {
+    switch (self->reader_.ReadChunk()) {
+      case FileReader::Result::kMore: {
+        ftl::RefPtr<ftl::TaskRunner> next_runner = task_runner;
+        next_runner->PostTask(ftl::MakeCopyable([
+          self = std::move(self), task_runner = std::move(task_runner)
+        ]() mutable { ReadChunk(std::move(self), std::move(task_runner)); }));
+        return;
+      }
+      case FileReader::Result::kDone: {
+        mx::vmo vmo;
+        bool success = self->reader_.Finish(&vmo);
+        self->SendCallback(success, std::move(vmo));
+        return;
+      }
+      case FileReader::Result::kError:
+        self->SendCallback(false, mx::vmo());
+        return;
+    }
+  }
+
+ private:
+  void SendCallback(bool success, mx::vmo vmo) {
+    auto callback = std::move(callback_);
+    callback_ = nullptr;
+    callback(success, std::move(vmo));
+  }
+
+  FileReader reader_;
+  std::function<void(bool, mx::vmo)> callback_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(AsyncFileReader);
+};
+
+}  // namespace
+
+bool VmoFromFd(ftl::UniqueFD fd, mx::vmo* handle_ptr) {
+  return VmoFromFd(std::move(fd), VmoFromFdOptions(), handle_ptr);
+}
+
+bool VmoFromFd(ftl::UniqueFD fd,
+               const VmoFromFdOptions& options,
+               mx::vmo* handle_ptr) {
+  FTL_CHECK(handle_ptr);
+
+  if (GetFileVmo(fd.get(), handle_ptr))
+    return true;
+
+  FileReader reader(std::move(fd), options);
+  for (;;) {
+    switch (reader.ReadChunk()) {
+      case FileReader::Result::kMore:
+        break;
+      case FileReader::Result::kDone:
+        return reader.Finish(handle_ptr);
+      case FileReader::Result::kError:
+        return false;
+    }
+  }
+}
+
+void VmoFromFdAsync(ftl::UniqueFD fd,
+                    const VmoFromFdOptions& options,
+                    ftl::RefPtr<ftl::TaskRunner> task_runner,
+                    const std::function<void(bool, mx::vmo)>& callback) {
+  FTL_DCHECK(task_runner);
+  FTL_DCHECK(callback);
+
+  mx::vmo vmo;
+  if (GetFileVmo(fd.get(), &vmo)) {
+    task_runner->PostTask(ftl::MakeCopyable(
+        [ callback, vmo = std::move(vmo) ]() mutable {
+          callback(true, std::move(vmo));
+        }));
+    return;
+  }
+
+  auto reader =
+      std::make_unique<AsyncFileReader>(std::move(fd), options, callback);
+  ftl::RefPtr<ftl::TaskRunner> first_runner = task_runner;
+  first_runner->PostTask(ftl::MakeCopyable([
+    reader = std::move(reader), task_runner = std::move(task_runner)
+  ]() mutable {
+    AsyncFileReader::ReadChunk(std::move(reader), std::move(task_runner));
+  }));
+}
+
 bool VmoFromFilename(const std::string& filename, mx::vmo* handle_ptr) {
   int fd = open(filename.c_str(), O_RDONLY);
   if (fd == -1) {
@@ -7,15 +7,55 @@
 
 #include <mx/vmo.h>
 
+#include <functional>
 #include <string>
 
 #include "lib/ftl/files/unique_fd.h"
 #include "lib/ftl/ftl_export.h"
+#include "lib/ftl/tasks/task_runner.h"
 
 namespace mtl {
 
+// Controls how files which the file system cannot provide as a VMO are read
+// into one.
+struct VmoFromFdOptions {
+  // The largest number of bytes requested from each |read|. Reads are aligned
+  // to this within the VMO: each one ends at a multiple of |chunk_size|, so a
+  // short read, as from a pipe, is followed by one which completes the chunk.
+  // Use a multiple of the page size so that chunks start on page boundaries.
+  size_t chunk_size = 256u * 1024u;
+
+  // How far the VMO is grown whenever it runs out of room, when the size of
+  // the file is not known up front. Rounded up to a whole number of chunks.
+  // The VMO grows by this much each time rather than geometrically.
+  size_t readahead = 4u * 1024u * 1024u;
+};
+
 // Make a new shared buffer with the contents of a file.
+//
+// Uses the file system's own VMO when it can provide one. Otherwise reads the
+// file in chunks directly into a mapped VMO, without buffering it on the heap.
 FTL_EXPORT bool VmoFromFd(ftl::UniqueFD fd, mx::vmo* handle_ptr);
+FTL_EXPORT bool VmoFromFd(ftl::UniqueFD fd,
+                          const VmoFromFdOptions& options,
+                          mx::vmo* handle_ptr);
+
+// Asynchronously makes a new shared buffer with the contents of a file. The
+// file is read one chunk per task, and the reads and |callback| are scheduled
+// on the given |task_runner|.
+//
+// Each read blocks until the file produces data, for example until the writer
+// of a pipe catches up, so |task_runner| should belong to a thread which is
+// free to block rather than one which serves other latency-sensitive work.
+//
+// If |task_runner| drops a pending read, for example because its message loop
+// is destroyed, |callback| is called with false on the thread which destroys
+// the task.
+FTL_EXPORT void VmoFromFdAsync(
+    ftl::UniqueFD fd,
+    const VmoFromFdOptions& options,
+    ftl::RefPtr<ftl::TaskRunner> task_runner,
+    const std::function<void(bool /*success*/, mx::vmo /*vmo*/)>& callback);
 
 // Make a new shared buffer with the contents of a file.
 FTL_EXPORT bool VmoFromFilename(const std::string& filename,
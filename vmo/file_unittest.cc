@@ -4,12 +4,16 @@
 
 #include <fcntl.h>
 #include <mx/vmo.h>
+#include <unistd.h>
 
 #include <string>
+#include <thread>
 
 #include "gtest/gtest.h"
 #include "lib/ftl/files/scoped_temp_dir.h"
+#include "lib/ftl/files/file_descriptor.h"
 #include "lib/ftl/files/unique_fd.h"
+#include "lib/mtl/tasks/message_loop.h"
 #include "lib/mtl/vmo/file.h"
 #include "lib/mtl/vmo/strings.h"
 
@@ -55,5 +59,118 @@ TEST(VMOAndFile, VmoFromFilename) {
   EXPECT_EQ("Another playload", data);
 }
 
+// Returns the read end of a pipe through which |content| is written, which the
+// file system cannot provide as a VMO.
+ftl::UniqueFD MakePipe(const std::string& content, std::thread* writer) {
+  int fds[2];
+  EXPECT_EQ(0, pipe(fds));
+  *writer = std::thread([ fd = fds[1], &content ] {
+    EXPECT_TRUE(ftl::WriteFileDescriptor(fd, content.data(), content.size()));
+    close(fd);
+  });
+  return ftl::UniqueFD(fds[0]);
+}
+
+std::string MakeContent(size_t size) {
+  std::string content(size, '\0');
+  for (size_t i = 0; i < size; i++)
+    content[i] = static_cast<char>('a' + i % 26);
+  return content;
+}
+
+TEST(VMOAndFile, VmoFromPipe) {
+  const std::string content = MakeContent(100000u);
+  std::thread writer;
+  ftl::UniqueFD fd = MakePipe(content, &writer);
+
+  mx::vmo vmo;
+  EXPECT_TRUE(VmoFromFd(std::move(fd), &vmo));
+  writer.join();
+
+  std::string data;
+  EXPECT_TRUE(StringFromVmo(vmo, &data));
+  EXPECT_EQ(content, data);
+}
+
+TEST(VMOAndFile, VmoFromPipeSmallChunks) {
+  const std::string content = MakeContent(3 * 4096 + 17);
+  std::thread writer;
+  ftl::UniqueFD fd = MakePipe(content, &writer);
+
+  VmoFromFdOptions options;
+  options.chunk_size = 1000u;
+  options.readahead = 1u;
+  mx::vmo vmo;
+  EXPECT_TRUE(VmoFromFd(std::move(fd), options, &vmo));
+  writer.join();
+
+  std::string data;
+  EXPECT_TRUE(StringFromVmo(vmo, &data));
+  EXPECT_EQ(content, data);
+}
+
+TEST(VMOAndFile, VmoFromEmptyPipe) {
+  const std::string content;
+  std::thread writer;
+  ftl::UniqueFD fd = MakePipe(content, &writer);
+
+  mx::vmo vmo;
+  EXPECT_TRUE(VmoFromFd(std::move(fd), &vmo));
+  writer.join();
+
+  std::string data = "stale";
+  EXPECT_TRUE(StringFromVmo(vmo, &data));
+  EXPECT_EQ("", data);
+}
+
+TEST(VMOAndFile, VmoFromFdAsync) {
+  const std::string content = MakeContent(50000u);
+  std::thread writer;
+  ftl::UniqueFD fd = MakePipe(content, &writer);
+
+  MessageLoop message_loop;
+  VmoFromFdOptions options;
+  options.chunk_size = 4096u;
+  bool success = false;
+  mx::vmo vmo;
+  VmoFromFdAsync(std::move(fd), options, message_loop.task_runner(),
+                 [&message_loop, &success, &vmo](bool success_value,
+                                                 mx::vmo vmo_value) {
+                   success = success_value;
+                   vmo = std::move(vmo_value);
+                   message_loop.QuitNow();
+                 });
+  message_loop.Run();
+  writer.join();
+
+  EXPECT_TRUE(success);
+  std::string data;
+  EXPECT_TRUE(StringFromVmo(vmo, &data));
+  EXPECT_EQ(content, data);
+}
+
+TEST(VMOAndFile, VmoFromFdAsyncDroppedTask) {
+  const std::string content;
+  std::thread writer;
+  ftl::UniqueFD fd = MakePipe(content, &writer);
+  writer.join();
+
+  int callback_count = 0;
+  bool success = true;
+  {
+    MessageLoop message_loop;
+    VmoFromFdAsync(std::move(fd), VmoFromFdOptions(),
+                   message_loop.task_runner(),
+                   [&callback_count, &success](bool success_value,
+                                               mx::vmo vmo_value) {
+                     callback_count++;
+                     success = success_value;
+                   });
+  }
+
+  EXPECT_EQ(1, callback_count);
+  EXPECT_FALSE(success);
+}
+
 }  // namespace
 }  // namespace mtl
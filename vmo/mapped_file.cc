@@ -0,0 +1,118 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/vmo/mapped_file.h"
+
+#include <list>
+#include <utility>
+
+#include "lib/ftl/logging.h"
+#include "lib/ftl/synchronization/mutex.h"
+#include "lib/ftl/synchronization/thread_annotations.h"
+#include "lib/mtl/vmo/file.h"
+
+namespace mtl {
+namespace {
+
+class FileCache {
+ public:
+  static FileCache* GetInstance() {
+    static FileCache* cache = new FileCache();
+    return cache;
+  }
+
+  ftl::RefPtr<MappedFile> Find(const std::string& path) {
+    ftl::MutexLocker locker(&mutex_);
+    for (auto it = files_.begin(); it != files_.end(); ++it) {
+      if ((*it)->path() == path) {
+        files_.splice(files_.begin(), files_, it);
+        return files_.front();
+      }
+    }
+    return nullptr;
+  }
+
+  // Returns the cached file for the same path if another thread opened it
+  // first, otherwise |file|.
+  ftl::RefPtr<MappedFile> Add(ftl::RefPtr<MappedFile> file) {
+    ftl::MutexLocker locker(&mutex_);
+    for (const auto& cached : files_) {
+      if (cached->path() == file->path())
+        return cached;
+    }
+    files_.push_front(file);
+
+    // Evict the least recently used files which nobody else references.
+    for (auto it = files_.end(); files_.size() > MappedFile::kMaxCachedFiles &&
+                                 it != files_.begin();) {
+      --it;
+      if ((*it)->HasOneRef())
+        it = files_.erase(it);
+    }
+    return file;
+  }
+
+  void Clear() {
+    ftl::MutexLocker locker(&mutex_);
+    files_.remove_if(
+        [](const ftl::RefPtr<MappedFile>& file) { return file->HasOneRef(); });
+  }
+
+ private:
+  ftl::Mutex mutex_;
+  // Most recently used first.
+  std::list<ftl::RefPtr<MappedFile>> files_ FTL_GUARDED_BY(mutex_);
+};
+
+}  // namespace
+
+constexpr size_t MappedFile::kMaxCachedFiles;
+
+MappedFile::MappedFile(std::string path, ftl::RefPtr<SharedVmo> shared_vmo)
+    : path_(std::move(path)), shared_vmo_(std::move(shared_vmo)) {
+  if (shared_vmo_->vmo_size()) {
+    data_ = ftl::StringView(static_cast<const char*>(shared_vmo_->Map()),
+                            shared_vmo_->vmo_size());
+  }
+}
+
+MappedFile::~MappedFile() {}
+
+ftl::RefPtr<MappedFile> MappedFile::Open(const std::string& path,
+                                         AccessHint hint) {
+  FileCache* cache = FileCache::GetInstance();
+  ftl::RefPtr<MappedFile> file = cache->Find(path);
+  if (file)
+    return file;
+
+  mx::vmo vmo;
+  if (!VmoFromFilename(path, &vmo))
+    return nullptr;
+
+  uint64_t vmo_size = 0u;
+  mx_status_t status = vmo.get_size(&vmo_size);
+  if (status != MX_OK) {
+    FTL_LOG(WARNING) << "mx::vmo::get_size failed: " << status;
+    return nullptr;
+  }
+
+  uint32_t map_flags = MX_VM_FLAG_PERM_READ;
+  if (hint == AccessHint::kSequential)
+    map_flags |= MX_VM_FLAG_MAP_RANGE;
+  // Empty files have nothing to map, and mapping them eagerly fails.
+  auto shared_vmo = ftl::MakeRefCounted<SharedVmo>(
+      std::move(vmo), map_flags,
+      vmo_size ? SharedVmo::MapTiming::kEager : SharedVmo::MapTiming::kLazy);
+  if (vmo_size && !shared_vmo->Map())
+    return nullptr;
+
+  return cache->Add(
+      ftl::AdoptRef(new MappedFile(path, std::move(shared_vmo))));
+}
+
+void MappedFile::ClearCache() {
+  FileCache::GetInstance()->Clear();
+}
+
+}  // namespace mtl
@@ -0,0 +1,74 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_MTL_VMO_MAPPED_FILE_H_
+#define LIB_MTL_VMO_MAPPED_FILE_H_
+
+#include <string>
+
+#include "lib/ftl/ftl_export.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/ref_counted.h"
+#include "lib/ftl/memory/ref_ptr.h"
+#include "lib/ftl/strings/string_view.h"
+#include "lib/mtl/vmo/shared_vmo.h"
+
+namespace mtl {
+
+// The read-only contents of a file, mapped into memory.
+//
+// Files are cached by path, so opening a file which is already open, or was
+// opened recently, shares the existing mapping instead of reading the file
+// again. The contents reflect the file as of the first open; use
+// |ClearCache| to observe later changes.
+//
+// This object is thread-safe.
+class FTL_EXPORT MappedFile : public ftl::RefCountedThreadSafe<MappedFile> {
+ public:
+  // How the contents are expected to be accessed.
+  enum class AccessHint {
+    kNormal,
+    // Pages are mapped up front, so a front-to-back scan does not fault on
+    // each page.
+    kSequential,
+  };
+
+  // The number of files which are kept mapped while nothing references them.
+  static constexpr size_t kMaxCachedFiles = 32u;
+
+  // Opens and maps the file at |path|. Returns nullptr if the file cannot be
+  // read or mapped.
+  //
+  // |hint| only applies when the file is not already cached.
+  static ftl::RefPtr<MappedFile> Open(const std::string& path,
+                                      AccessHint hint = AccessHint::kNormal);
+
+  // Drops all cached files which are not referenced elsewhere.
+  static void ClearCache();
+
+  const std::string& path() const { return path_; }
+
+  // Gets the contents of the file. Remains valid for the lifetime of this
+  // object.
+  ftl::StringView data() const { return data_; }
+  size_t size() const { return data_.size(); }
+
+  // Gets the underlying VMO, for example to share it with another process.
+  const ftl::RefPtr<SharedVmo>& shared_vmo() const { return shared_vmo_; }
+
+ private:
+  MappedFile(std::string path, ftl::RefPtr<SharedVmo> shared_vmo);
+  ~MappedFile();
+
+  std::string const path_;
+  ftl::RefPtr<SharedVmo> const shared_vmo_;
+  ftl::StringView data_;
+
+  FRIEND_REF_COUNTED_THREAD_SAFE(MappedFile);
+  FTL_DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+}  // namespace mtl
+
+#endif  // LIB_MTL_VMO_MAPPED_FILE_H_
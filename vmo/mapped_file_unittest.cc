@@ -0,0 +1,68 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/vmo/mapped_file.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/ftl/files/file.h"
+#include "lib/ftl/files/scoped_temp_dir.h"
+
+namespace mtl {
+namespace {
+
+TEST(MappedFile, Open) {
+  files::ScopedTempDir temp_dir;
+  std::string path;
+  ASSERT_TRUE(temp_dir.NewTempFile(&path));
+  ASSERT_TRUE(files::WriteFile(path, "Payload", 7));
+
+  auto file = MappedFile::Open(path, MappedFile::AccessHint::kSequential);
+  ASSERT_NE(nullptr, file.get());
+  EXPECT_EQ(path, file->path());
+  EXPECT_EQ("Payload", file->data().ToString());
+  EXPECT_EQ(7u, file->size());
+  EXPECT_NE(nullptr, file->shared_vmo().get());
+}
+
+TEST(MappedFile, SharesMappingPerPath) {
+  files::ScopedTempDir temp_dir;
+  std::string path;
+  ASSERT_TRUE(temp_dir.NewTempFile(&path));
+  ASSERT_TRUE(files::WriteFile(path, "first", 5));
+
+  auto file = MappedFile::Open(path);
+  ASSERT_NE(nullptr, file.get());
+  EXPECT_EQ(file.get(), MappedFile::Open(path).get());
+
+  // Referenced files survive clearing the cache.
+  ASSERT_TRUE(files::WriteFile(path, "second", 6));
+  MappedFile::ClearCache();
+  EXPECT_EQ(file.get(), MappedFile::Open(path).get());
+
+  file = nullptr;
+  MappedFile::ClearCache();
+  file = MappedFile::Open(path);
+  ASSERT_NE(nullptr, file.get());
+  EXPECT_EQ("second", file->data().ToString());
+}
+
+TEST(MappedFile, EmptyFile) {
+  files::ScopedTempDir temp_dir;
+  std::string path;
+  ASSERT_TRUE(temp_dir.NewTempFile(&path));
+
+  auto file = MappedFile::Open(path);
+  ASSERT_NE(nullptr, file.get());
+  EXPECT_TRUE(file->data().empty());
+}
+
+TEST(MappedFile, MissingFile) {
+  files::ScopedTempDir temp_dir;
+  EXPECT_EQ(nullptr, MappedFile::Open(temp_dir.path() + "/missing").get());
+}
+
+}  // namespace
+}  // namespace mtl
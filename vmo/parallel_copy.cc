@@ -0,0 +1,139 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/vmo/parallel_copy.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include "lib/ftl/logging.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/synchronization/waitable_event.h"
+
+namespace mtl {
+namespace {
+
+constexpr uint64_t kPageSize = 4096u;
+
+// Chunks are never smaller than this, so small copies use fewer threads.
+constexpr size_t kMinChunkSize = 256u * 1024u;
+
+// Copies |length| bytes between the VMO at |vmo_offset| and the buffer at
+// |buffer_offset|.
+using CopyFunction = std::function<
+    mx_status_t(uint64_t vmo_offset, size_t buffer_offset, size_t length)>;
+
+// Signals an event when destroyed, whether or not the closures which share
+// it ever ran.
+class SignalOnDestruction {
+ public:
+  explicit SignalOnDestruction(ftl::AutoResetWaitableEvent* event)
+      : event_(event) {}
+  ~SignalOnDestruction() { event_->Signal(); }
+
+ private:
+  ftl::AutoResetWaitableEvent* const event_;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(SignalOnDestruction);
+};
+
+bool CopyChunk(const CopyFunction& copy,
+               uint64_t vmo_offset,
+               size_t buffer_offset,
+               size_t length) {
+  mx_status_t status = copy(vmo_offset, buffer_offset, length);
+  if (status != MX_OK) {
+    FTL_LOG(WARNING) << "Failed to copy vmo chunk: offset=" << vmo_offset
+                     << ", length=" << length << ", status=" << status;
+    return false;
+  }
+  return true;
+}
+
+bool ParallelCopy(uint64_t offset,
+                  size_t size,
+                  const std::vector<ftl::RefPtr<ftl::TaskRunner>>& workers,
+                  size_t serial_threshold,
+                  const CopyFunction& copy) {
+  size_t chunk_count = std::min(workers.size() + 1u,
+                                (size + kMinChunkSize - 1u) / kMinChunkSize);
+  if (size < serial_threshold || chunk_count <= 1u)
+    return CopyChunk(copy, offset, 0u, size);
+
+  // Chunk boundaries fall on page boundaries of the VMO so that no page is
+  // written by two threads.
+  const uint64_t end = offset + size;
+  const uint64_t chunk_size =
+      ((size + chunk_count - 1u) / chunk_count + kPageSize - 1u) &
+      ~(kPageSize - 1u);
+  std::vector<uint64_t> bounds;
+  bounds.push_back(offset);
+  for (size_t i = 1u; i < chunk_count; i++) {
+    uint64_t bound = (offset + i * chunk_size) & ~(kPageSize - 1u);
+    if (bound > bounds.back() && bound < end)
+      bounds.push_back(bound);
+  }
+  bounds.push_back(end);
+  chunk_count = bounds.size() - 1u;
+
+  // Each chunk records its own result; chunks whose tasks are dropped keep
+  // the initial failure.
+  std::vector<char> succeeded(chunk_count, false);
+  ftl::AutoResetWaitableEvent done;
+  auto signal = std::make_shared<SignalOnDestruction>(&done);
+  for (size_t i = 1u; i < chunk_count; i++) {
+    workers[i - 1u]->PostTask([&copy, &bounds, &succeeded, offset, i, signal] {
+      succeeded[i] = CopyChunk(copy, bounds[i], bounds[i] - offset,
+                               bounds[i + 1u] - bounds[i]);
+    });
+  }
+  signal.reset();
+
+  succeeded[0] = CopyChunk(copy, bounds[0], 0u, bounds[1] - bounds[0]);
+  done.Wait();
+
+  return std::all_of(succeeded.begin(), succeeded.end(),
+                     [](char value) { return value; });
+}
+
+}  // namespace
+
+bool ParallelVmoWrite(const mx::vmo& vmo,
+                      uint64_t offset,
+                      const void* data,
+                      size_t size,
+                      const std::vector<ftl::RefPtr<ftl::TaskRunner>>& workers,
+                      size_t serial_threshold) {
+  const char* source = static_cast<const char*>(data);
+  return ParallelCopy(
+      offset, size, workers, serial_threshold,
+      [&vmo, source](uint64_t vmo_offset, size_t buffer_offset,
+                     size_t length) {
+        size_t actual;
+        mx_status_t status =
+            vmo.write(source + buffer_offset, vmo_offset, length, &actual);
+        return status == MX_OK && actual != length ? MX_ERR_IO : status;
+      });
+}
+
+bool ParallelVmoRead(const mx::vmo& vmo,
+                     uint64_t offset,
+                     void* data,
+                     size_t size,
+                     const std::vector<ftl::RefPtr<ftl::TaskRunner>>& workers,
+                     size_t serial_threshold) {
+  char* destination = static_cast<char*>(data);
+  return ParallelCopy(
+      offset, size, workers, serial_threshold,
+      [&vmo, destination](uint64_t vmo_offset, size_t buffer_offset,
+                          size_t length) {
+        size_t actual;
+        mx_status_t status =
+            vmo.read(destination + buffer_offset, vmo_offset, length, &actual);
+        return status == MX_OK && actual != length ? MX_ERR_IO : status;
+      });
+}
+
+}  // namespace mtl
@@ -0,0 +1,51 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_MTL_VMO_PARALLEL_COPY_H_
+#define LIB_MTL_VMO_PARALLEL_COPY_H_
+
+#include <mx/vmo.h>
+
+#include <vector>
+
+#include "lib/ftl/ftl_export.h"
+#include "lib/ftl/memory/ref_ptr.h"
+#include "lib/ftl/tasks/task_runner.h"
+
+namespace mtl {
+
+// Copies smaller than this are done serially on the calling thread by
+// default, since handing chunks to other threads costs more than it saves.
+constexpr size_t kDefaultParallelCopyThreshold = 4u * 1024u * 1024u;
+
+// Writes |size| bytes from |data| into |vmo| at |offset|.
+//
+// Copies of at least |serial_threshold| bytes are split into page-aligned
+// chunks which are written concurrently by the calling thread and
+// |workers|. Blocks until every chunk is done, so |workers| must not include
+// the calling thread's own task runner.
+//
+// Returns false if any chunk could not be written, including when a worker
+// drops its task.
+FTL_EXPORT bool ParallelVmoWrite(
+    const mx::vmo& vmo,
+    uint64_t offset,
+    const void* data,
+    size_t size,
+    const std::vector<ftl::RefPtr<ftl::TaskRunner>>& workers,
+    size_t serial_threshold = kDefaultParallelCopyThreshold);
+
+// Reads |size| bytes from |vmo| at |offset| into |data|, like
+// |ParallelVmoWrite|.
+FTL_EXPORT bool ParallelVmoRead(
+    const mx::vmo& vmo,
+    uint64_t offset,
+    void* data,
+    size_t size,
+    const std::vector<ftl::RefPtr<ftl::TaskRunner>>& workers,
+    size_t serial_threshold = kDefaultParallelCopyThreshold);
+
+}  // namespace mtl
+
+#endif  // LIB_MTL_VMO_PARALLEL_COPY_H_
@@ -0,0 +1,70 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/vmo/parallel_copy.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/mtl/threading/loop_group.h"
+
+namespace mtl {
+namespace {
+
+std::vector<ftl::RefPtr<ftl::TaskRunner>> GetWorkers(const LoopGroup& group) {
+  std::vector<ftl::RefPtr<ftl::TaskRunner>> workers;
+  for (size_t i = 0; i < group.thread_count(); i++)
+    workers.push_back(group.task_runner(i));
+  return workers;
+}
+
+std::string MakeContent(size_t size) {
+  std::string content(size, '\0');
+  for (size_t i = 0; i < size; i++)
+    content[i] = static_cast<char>(i * 31 + i / 4096);
+  return content;
+}
+
+TEST(ParallelCopy, WriteAndRead) {
+  LoopGroup group(3u);
+  auto workers = GetWorkers(group);
+  const std::string content = MakeContent(3 * 1024 * 1024 + 123);
+
+  mx::vmo vmo;
+  ASSERT_EQ(MX_OK, mx::vmo::create(content.size() + 4096u, 0u, &vmo));
+  EXPECT_TRUE(ParallelVmoWrite(vmo, 100u, content.data(), content.size(),
+                               workers, 0u));
+
+  std::string out(content.size(), '\0');
+  EXPECT_TRUE(ParallelVmoRead(vmo, 100u, &out[0], out.size(), workers, 0u));
+  EXPECT_EQ(content, out);
+}
+
+TEST(ParallelCopy, SerialBelowThreshold) {
+  const std::string content = MakeContent(10000u);
+  mx::vmo vmo;
+  ASSERT_EQ(MX_OK, mx::vmo::create(content.size(), 0u, &vmo));
+
+  // No workers are needed below the threshold.
+  std::vector<ftl::RefPtr<ftl::TaskRunner>> workers;
+  EXPECT_TRUE(
+      ParallelVmoWrite(vmo, 0u, content.data(), content.size(), workers));
+  std::string out(content.size(), '\0');
+  EXPECT_TRUE(ParallelVmoRead(vmo, 0u, &out[0], out.size(), workers));
+  EXPECT_EQ(content, out);
+}
+
+TEST(ParallelCopy, OutOfRange) {
+  LoopGroup group(2u);
+  auto workers = GetWorkers(group);
+  const std::string content = MakeContent(2 * 1024 * 1024);
+
+  mx::vmo vmo;
+  ASSERT_EQ(MX_OK, mx::vmo::create(1024 * 1024, 0u, &vmo));
+  EXPECT_FALSE(ParallelVmoWrite(vmo, 0u, content.data(), content.size(),
+                                workers, 0u));
+}
+
+}  // namespace
+}  // namespace mtl
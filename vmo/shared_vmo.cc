@@ -6,40 +6,157 @@
 
 #include <mx/vmar.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "lib/ftl/logging.h"
 
 namespace mtl {
 
 static_assert(sizeof(size_t) == sizeof(uint64_t), "64-bit architecture");
 
-SharedVmo::SharedVmo(mx::vmo vmo, uint32_t map_flags)
+namespace {
+
+constexpr uint64_t kPageSize = 4096u;
+
+uint64_t RoundDownToPage(uint64_t value) {
+  return value & ~(kPageSize - 1u);
+}
+
+uint64_t RoundUpToPage(uint64_t value) {
+  return RoundDownToPage(value + kPageSize - 1u);
+}
+
+// Copies the first |size| bytes of |source| into a new VMO.
+mx_status_t CopyVmo(const mx::vmo& source, uint64_t size, mx::vmo* result) {
+  mx::vmo copy;
+  mx_status_t status = mx::vmo::create(size, 0u, &copy);
+  if (status != MX_OK)
+    return status;
+
+  std::vector<char> buffer(std::min<uint64_t>(size, 64u * 1024u));
+  for (uint64_t offset = 0u; offset < size;) {
+    size_t length = std::min<uint64_t>(size - offset, buffer.size());
+    size_t actual;
+    status = source.read(buffer.data(), offset, length, &actual);
+    if (status != MX_OK)
+      return status;
+    if (actual == 0u)
+      return MX_ERR_IO;
+    status = copy.write(buffer.data(), offset, actual, &actual);
+    if (status != MX_OK)
+      return status;
+    offset += actual;
+  }
+
+  *result = std::move(copy);
+  return MX_OK;
+}
+
+}  // namespace
+
+constexpr size_t SharedVmo::kMaxCachedRanges;
+
+SharedVmo::Mapping::Mapping(uintptr_t address, uint64_t offset, size_t size)
+    : address_(address), offset_(offset), size_(size) {}
+
+SharedVmo::Mapping::~Mapping() {
+  mx_status_t status = mx::vmar::root_self().unmap(address_, size_);
+  FTL_CHECK(status == MX_OK);
+}
+
+void* SharedVmo::Mapping::At(uint64_t vmo_offset) const {
+  FTL_DCHECK(vmo_offset >= offset_ && vmo_offset - offset_ < size_);
+  return reinterpret_cast<void*>(address_ + (vmo_offset - offset_));
+}
+
+SharedVmo::SharedVmo(mx::vmo vmo, uint32_t map_flags, MapTiming map_timing)
     : vmo_(std::move(vmo)), map_flags_(map_flags) {
   FTL_DCHECK(vmo_);
 
   mx_status_t status = vmo_.get_size(&vmo_size_);
   FTL_CHECK(status == MX_OK);
+
+  if (map_timing == MapTiming::kEager)
+    MapSlow();
 }
 
 SharedVmo::~SharedVmo() {
-  if (mapping_) {
-    mx_status_t status = mx::vmar::root_self().unmap(mapping_, vmo_size_);
+  uintptr_t mapping = mapping_.load(std::memory_order_relaxed);
+  if (mapping) {
+    mx_status_t status = mx::vmar::root_self().unmap(mapping, vmo_size_);
     FTL_CHECK(status == MX_OK);
   }
 }
 
-void* SharedVmo::Map() {
-  if (vmo_ && map_flags_) {
-    std::call_once(mapping_once_flag_, [this] {
-      // If an error occurs, then |mapping_| will remain 0.
-      mx_status_t status = mx::vmar::root_self().map(0, vmo_, 0u, vmo_size_,
-                                                     map_flags_, &mapping_);
-      if (status != MX_OK) {
-        FTL_LOG(ERROR) << "Failed to map vmo: vmo_size=" << vmo_size_
-                       << ", map_flags=" << map_flags_ << ", status=" << status;
-      }
-    });
+void* SharedVmo::MapSlow() {
+  if (!vmo_ || !map_flags_)
+    return nullptr;
+
+  ftl::MutexLocker locker(&mapping_mutex_);
+  if (!map_attempted_) {
+    map_attempted_ = true;
+
+    // If an error occurs, then |mapping_| will remain 0.
+    uintptr_t mapping = 0u;
+    mx_status_t status = mx::vmar::root_self().map(0, vmo_, 0u, vmo_size_,
+                                                   map_flags_, &mapping);
+    if (status == MX_OK) {
+      mapping_.store(mapping, std::memory_order_release);
+    } else {
+      FTL_LOG(ERROR) << "Failed to map vmo: vmo_size=" << vmo_size_
+                     << ", map_flags=" << map_flags_ << ", status=" << status;
+    }
+  }
+  return reinterpret_cast<void*>(mapping_.load(std::memory_order_relaxed));
+}
+
+ftl::RefPtr<SharedVmo::Mapping> SharedVmo::MapRange(uint64_t offset,
+                                                     size_t length) {
+  FTL_DCHECK(length > 0u);
+  if (!vmo_ || !map_flags_ || offset > vmo_size_ ||
+      length > vmo_size_ - offset)
+    return nullptr;
+
+  ftl::MutexLocker locker(&range_mutex_);
+  for (auto it = cached_ranges_.begin(); it != cached_ranges_.end(); ++it) {
+    if ((*it)->Contains(offset, length)) {
+      cached_ranges_.splice(cached_ranges_.begin(), cached_ranges_, it);
+      return cached_ranges_.front();
+    }
+  }
+
+  uint64_t map_offset = RoundDownToPage(offset);
+  uint64_t map_size = RoundUpToPage(offset + length) - map_offset;
+  uintptr_t address = 0u;
+  mx_status_t status = mx::vmar::root_self().map(0, vmo_, map_offset, map_size,
+                                                 map_flags_, &address);
+  if (status != MX_OK) {
+    FTL_LOG(ERROR) << "Failed to map vmo range: offset=" << map_offset
+                   << ", size=" << map_size << ", map_flags=" << map_flags_
+                   << ", status=" << status;
+    return nullptr;
+  }
+
+  auto mapping = ftl::AdoptRef(new Mapping(address, map_offset, map_size));
+  cached_ranges_.push_front(mapping);
+  if (cached_ranges_.size() > kMaxCachedRanges)
+    cached_ranges_.pop_back();
+  return mapping;
+}
+
+ftl::RefPtr<SharedVmo> SharedVmo::Snapshot() const {
+  mx::vmo snapshot;
+  mx_status_t status =
+      vmo_.clone(MX_VMO_CLONE_COPY_ON_WRITE, 0u, vmo_size_, &snapshot);
+  if (status == MX_ERR_NOT_SUPPORTED || status == MX_ERR_ACCESS_DENIED)
+    status = CopyVmo(vmo_, vmo_size_, &snapshot);
+  if (status != MX_OK) {
+    FTL_LOG(ERROR) << "Failed to snapshot vmo: vmo_size=" << vmo_size_
+                   << ", status=" << status;
+    return nullptr;
   }
-  return reinterpret_cast<void*>(mapping_);
+  return ftl::MakeRefCounted<SharedVmo>(std::move(snapshot), map_flags_);
 }
 
 }  // namespace mtl
@@ -5,13 +5,17 @@
 #ifndef LIB_MTL_VMO_SHARED_VMO_H_
 #define LIB_MTL_VMO_SHARED_VMO_H_
 
-#include <mutex>
+#include <atomic>
+#include <list>
 
 #include <mx/vmo.h>
 
 #include "lib/ftl/ftl_export.h"
 #include "lib/ftl/macros.h"
 #include "lib/ftl/memory/ref_counted.h"
+#include "lib/ftl/memory/ref_ptr.h"
+#include "lib/ftl/synchronization/mutex.h"
+#include "lib/ftl/synchronization/thread_annotations.h"
 
 namespace mtl {
 
@@ -22,12 +26,55 @@ namespace mtl {
 // This object is thread-safe.
 class FTL_EXPORT SharedVmo : public ftl::RefCountedThreadSafe<SharedVmo> {
  public:
+  // A page-aligned window of the VMO which is mapped into memory.
+  // The window remains mapped until all references to it have been released,
+  // even if the |SharedVmo| it came from is destroyed first.
+  class FTL_EXPORT Mapping : public ftl::RefCountedThreadSafe<Mapping> {
+   public:
+    // Gets the offset and size of the mapped window within the VMO.
+    uint64_t offset() const { return offset_; }
+    size_t size() const { return size_; }
+
+    // Returns true if the window covers |length| bytes at |vmo_offset|.
+    bool Contains(uint64_t vmo_offset, size_t length) const {
+      return vmo_offset >= offset_ && length <= size_ &&
+             vmo_offset - offset_ <= size_ - length;
+    }
+
+    // Returns the address of the byte at |vmo_offset| within the VMO, which
+    // must be inside the window.
+    void* At(uint64_t vmo_offset) const;
+
+   private:
+    Mapping(uintptr_t address, uint64_t offset, size_t size);
+    ~Mapping();
+
+    uintptr_t const address_;
+    uint64_t const offset_;
+    size_t const size_;
+
+    friend class SharedVmo;
+    FRIEND_REF_COUNTED_THREAD_SAFE(Mapping);
+    FTL_DISALLOW_COPY_AND_ASSIGN(Mapping);
+  };
+
+  // When the VMO is mapped by |Map|.
+  enum class MapTiming {
+    // On the first call to |Map|.
+    kLazy,
+    // When the object is constructed, so that the first reader does not pay
+    // for the mapping.
+    kEager,
+  };
+
   // Initializes a shared VMO.
   //
   // |vmo| must be a valid VMO handle.
   // If not zero, |map_flags| specifies the flags which should be passed to
   // |mx::vmar::map| when the VMO is mapped.
-  explicit SharedVmo(mx::vmo vmo, uint32_t map_flags = 0u);
+  explicit SharedVmo(mx::vmo vmo,
+                     uint32_t map_flags = 0u,
+                     MapTiming map_timing = MapTiming::kLazy);
 
   virtual ~SharedVmo();
 
@@ -42,15 +89,49 @@ class FTL_EXPORT SharedVmo : public ftl::RefCountedThreadSafe<SharedVmo> {
 
   // Maps the entire VMO into memory (if not already mapped).
   // Returns the address of the mapping or nullptr if an error occurred.
-  void* Map();
+  //
+  // Once the VMO is mapped this is a single atomic load.
+  void* Map() {
+    uintptr_t mapping = mapping_.load(std::memory_order_acquire);
+    return mapping ? reinterpret_cast<void*>(mapping) : MapSlow();
+  }
+
+  // Maps a window of the VMO which covers at least |length| bytes at |offset|
+  // (if not already mapped), so that only part of a large VMO needs to be
+  // in the address space. Use |Mapping::At| to locate the data.
+  //
+  // Recently used windows are cached and reused by later calls which fall
+  // within them. Returns nullptr if the VMO is not mappable, the range is
+  // out of bounds, or an error occurred.
+  ftl::RefPtr<Mapping> MapRange(uint64_t offset, size_t length);
+
+  // Creates a point-in-time copy of the VMO's contents which later writes to
+  // this VMO do not affect, and wraps it with the same |map_flags|.
+  //
+  // The copy is a copy-on-write clone, so its cost is proportional to the
+  // number of pages subsequently written rather than to the size of the VMO.
+  // Falls back to copying the contents if the VMO cannot be cloned.
+  // Returns nullptr if an error occurred.
+  ftl::RefPtr<SharedVmo> Snapshot() const;
+
+  // The number of windows kept alive by |MapRange| for reuse.
+  static constexpr size_t kMaxCachedRanges = 8u;
 
  private:
   mx::vmo const vmo_;
   uint32_t const map_flags_;
   size_t vmo_size_;
 
-  std::once_flag mapping_once_flag_{};
-  uintptr_t mapping_ = 0u;
+  void* MapSlow();
+
+  std::atomic<uintptr_t> mapping_{0u};
+  ftl::Mutex mapping_mutex_;
+  // Set once mapping has been attempted, so failures are not retried.
+  bool map_attempted_ FTL_GUARDED_BY(mapping_mutex_) = false;
+
+  ftl::Mutex range_mutex_;
+  // Most recently used first.
+  std::list<ftl::RefPtr<Mapping>> cached_ranges_ FTL_GUARDED_BY(range_mutex_);
 
   FRIEND_REF_COUNTED_THREAD_SAFE(SharedVmo);
   FTL_DISALLOW_COPY_AND_ASSIGN(SharedVmo);
@@ -6,6 +6,9 @@
 
 #include <string.h>
 
+#include <thread>
+#include <vector>
+
 #include "lib/mtl/vmo/strings.h"
 #include "gtest/gtest.h"
 
@@ -44,5 +47,127 @@ TEST(SharedVmos, Mapped) {
   EXPECT_EQ(data, static_cast<const char*>(shared_vmo->Map()));
 }
 
+TEST(SharedVmos, MappedEagerly) {
+  std::string content("hello");
+  mx::vmo vmo;
+  ASSERT_TRUE(VmoFromString(content, &vmo));
+
+  auto shared_vmo = ftl::MakeRefCounted<SharedVmo>(
+      std::move(vmo), MX_VM_FLAG_PERM_READ, SharedVmo::MapTiming::kEager);
+  const char* data = static_cast<const char*>(shared_vmo->Map());
+  EXPECT_NE(nullptr, data);
+  EXPECT_EQ(0, memcmp(content.c_str(), data, content.size()));
+}
+
+TEST(SharedVmos, ConcurrentMap) {
+  mx::vmo vmo;
+  ASSERT_TRUE(VmoFromString("hello", &vmo));
+
+  auto shared_vmo =
+      ftl::MakeRefCounted<SharedVmo>(std::move(vmo), MX_VM_FLAG_PERM_READ);
+  std::vector<void*> results(8u);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < results.size(); i++) {
+    threads.emplace_back(
+        [&shared_vmo, &results, i] { results[i] = shared_vmo->Map(); });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  EXPECT_NE(nullptr, results[0]);
+  for (void* result : results)
+    EXPECT_EQ(results[0], result);
+}
+
+TEST(SharedVmos, Snapshot) {
+  mx::vmo vmo;
+  ASSERT_TRUE(VmoFromString("hello", &vmo));
+
+  auto shared_vmo =
+      ftl::MakeRefCounted<SharedVmo>(std::move(vmo), MX_VM_FLAG_PERM_READ);
+  auto snapshot = shared_vmo->Snapshot();
+  ASSERT_NE(nullptr, snapshot.get());
+  EXPECT_NE(shared_vmo->vmo().get(), snapshot->vmo().get());
+  EXPECT_EQ(5u, snapshot->vmo_size());
+  EXPECT_EQ(MX_VM_FLAG_PERM_READ, snapshot->map_flags());
+
+  // Writes to the original are not visible through the snapshot.
+  size_t actual;
+  ASSERT_EQ(MX_OK, shared_vmo->vmo().write("j", 0u, 1u, &actual));
+  std::string content;
+  EXPECT_TRUE(StringFromVmo(shared_vmo->vmo(), &content));
+  EXPECT_EQ("jello", content);
+  EXPECT_TRUE(StringFromVmo(snapshot->vmo(), &content));
+  EXPECT_EQ("hello", content);
+}
+
+TEST(SharedVmos, MapRange) {
+  std::string content(3 * 4096 + 100, 'a');
+  content.replace(5000, 5, "hello");
+  mx::vmo vmo;
+  ASSERT_TRUE(VmoFromString(content, &vmo));
+
+  auto shared_vmo =
+      ftl::MakeRefCounted<SharedVmo>(std::move(vmo), MX_VM_FLAG_PERM_READ);
+  auto mapping = shared_vmo->MapRange(5000u, 5u);
+  ASSERT_NE(nullptr, mapping.get());
+  EXPECT_EQ(4096u, mapping->offset());
+  EXPECT_EQ(4096u, mapping->size());
+  EXPECT_TRUE(mapping->Contains(5000u, 5u));
+  EXPECT_EQ(0, memcmp("hello", mapping->At(5000u), 5u));
+
+  // A range within a cached window reuses it.
+  EXPECT_EQ(mapping.get(), shared_vmo->MapRange(4096u, 4096u).get());
+
+  // A range spanning pages maps a new window.
+  auto tail = shared_vmo->MapRange(8000u, content.size() - 8000u);
+  ASSERT_NE(nullptr, tail.get());
+  EXPECT_NE(mapping.get(), tail.get());
+  EXPECT_EQ(0, memcmp(content.data() + 8000u, tail->At(8000u),
+                      content.size() - 8000u));
+
+  // The window outlives the shared VMO.
+  shared_vmo = nullptr;
+  EXPECT_EQ(0, memcmp("hello", mapping->At(5000u), 5u));
+}
+
+TEST(SharedVmos, MapRangeOutOfBounds) {
+  mx::vmo vmo;
+  ASSERT_TRUE(VmoFromString("hello", &vmo));
+
+  auto shared_vmo =
+      ftl::MakeRefCounted<SharedVmo>(std::move(vmo), MX_VM_FLAG_PERM_READ);
+  EXPECT_EQ(nullptr, shared_vmo->MapRange(3u, 3u).get());
+  EXPECT_NE(nullptr, shared_vmo->MapRange(3u, 2u).get());
+}
+
+TEST(SharedVmos, MapRangeUnmappable) {
+  mx::vmo vmo;
+  ASSERT_TRUE(VmoFromString("hello", &vmo));
+
+  auto shared_vmo = ftl::MakeRefCounted<SharedVmo>(std::move(vmo));
+  EXPECT_EQ(nullptr, shared_vmo->MapRange(0u, 5u).get());
+}
+
+TEST(SharedVmos, MapRangeEvictsLeastRecentlyUsed) {
+  const size_t page_count = SharedVmo::kMaxCachedRanges + 1u;
+  mx::vmo vmo;
+  ASSERT_TRUE(VmoFromString(std::string(page_count * 4096u, 'a'), &vmo));
+
+  auto shared_vmo =
+      ftl::MakeRefCounted<SharedVmo>(std::move(vmo), MX_VM_FLAG_PERM_READ);
+  auto first = shared_vmo->MapRange(0u, 1u);
+  ASSERT_NE(nullptr, first.get());
+  for (size_t i = 1u; i < page_count; i++)
+    ASSERT_NE(nullptr, shared_vmo->MapRange(i * 4096u, 1u).get());
+
+  // The first window was evicted, so a new one is mapped. The evicted window
+  // stays valid while referenced.
+  auto mapping = shared_vmo->MapRange(0u, 1u);
+  ASSERT_NE(nullptr, mapping.get());
+  EXPECT_NE(first.get(), mapping.get());
+  EXPECT_EQ('a', *static_cast<const char*>(first->At(0u)));
+}
+
 }  // namespace
 }  // namespace mtl
@@ -13,11 +13,18 @@
 #include "lib/ftl/strings/string_view.h"
 
 namespace mtl {
+class VmoPool;
 
 // Make a new shared buffer with the contents of a string.
 FTL_EXPORT bool VmoFromString(const ftl::StringView& string,
                               mx::vmo* handle_ptr);
 
+// Make a new shared buffer with the contents of a string, taking the buffer
+// from |pool|.
+FTL_EXPORT bool VmoFromString(const ftl::StringView& string,
+                              VmoPool* pool,
+                              mx::vmo* handle_ptr);
+
 // Copy the contents of a shared buffer into a string.
 FTL_EXPORT bool StringFromVmo(const mx::vmo& handle, std::string* string_ptr);
 
@@ -38,5 +38,35 @@ TEST(VmoStrings, BinaryString) {
   EXPECT_EQ(binary_string, binary_out);
 }
 
+// Large strings are copied through a mapping of the VMO.
+TEST(VmoStrings, LargeString) {
+  std::string large_string(1024 * 1024 + 3, '\0');
+  for (size_t i = 0; i < large_string.size(); i++) {
+    large_string[i] = (char)(i * 7);
+  }
+  mx::vmo large_buffer;
+  EXPECT_TRUE(VmoFromString(large_string, &large_buffer));
+  std::string large_out = "stale contents";
+  EXPECT_TRUE(StringFromVmo(std::move(large_buffer), &large_out));
+  EXPECT_EQ(large_string, large_out);
+}
+
+// Large strings are still readable through handles that cannot be mapped.
+TEST(VmoStrings, LargeStringWithoutMapRight) {
+  std::string large_string(1024 * 1024 + 3, '\0');
+  for (size_t i = 0; i < large_string.size(); i++) {
+    large_string[i] = (char)(i * 7);
+  }
+  mx::vmo large_buffer;
+  EXPECT_TRUE(VmoFromString(large_string, &large_buffer));
+  mx::vmo read_only;
+  ASSERT_EQ(MX_OK, large_buffer.duplicate(
+                       MX_RIGHT_READ | MX_RIGHT_DUPLICATE | MX_RIGHT_TRANSFER,
+                       &read_only));
+  std::string large_out;
+  EXPECT_TRUE(StringFromVmo(read_only, &large_out));
+  EXPECT_EQ(large_string, large_out);
+}
+
 }  // namespace
 }  // namespace mtl
@@ -12,11 +12,18 @@
 #include "lib/ftl/ftl_export.h"
 
 namespace mtl {
+class VmoPool;
 
 // Make a new shared buffer with the contents of a char vector.
 FTL_EXPORT bool VmoFromVector(const std::vector<char>& vector,
                               mx::vmo* handle_ptr);
 
+// Make a new shared buffer with the contents of a char vector, taking the
+// buffer from |pool|.
+FTL_EXPORT bool VmoFromVector(const std::vector<char>& vector,
+                              VmoPool* pool,
+                              mx::vmo* handle_ptr);
+
 // Copy the contents of a shared buffer into a char vector.
 FTL_EXPORT bool VectorFromVmo(const mx::vmo& shared_buffer,
                               std::vector<char>* vector_ptr);
@@ -25,6 +32,12 @@ FTL_EXPORT bool VectorFromVmo(const mx::vmo& shared_buffer,
 FTL_EXPORT bool VmoFromVector(const std::vector<uint8_t>& vector,
                               mx::vmo* handle_ptr);
 
+// Make a new shared buffer with the contents of a uint8_t vector, taking the
+// buffer from |pool|.
+FTL_EXPORT bool VmoFromVector(const std::vector<uint8_t>& vector,
+                              VmoPool* pool,
+                              mx::vmo* handle_ptr);
+
 // Copy the contents of a shared buffer into a uint8_t vector.
 FTL_EXPORT bool VectorFromVmo(const mx::vmo& shared_buffer,
                               std::vector<uint8_t>* vector_ptr);
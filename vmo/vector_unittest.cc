@@ -26,5 +26,16 @@ TEST(VmoVector, EmptyVector) {
   EXPECT_EQ(v, v_out);
 }
 
+TEST(VmoVector, LargeVector) {
+  std::vector<uint8_t> v(256 * 1024 + 1);
+  for (size_t i = 0; i < v.size(); i++)
+    v[i] = static_cast<uint8_t>(i);
+  mx::vmo sb;
+  EXPECT_TRUE(VmoFromVector(v, &sb));
+  std::vector<uint8_t> v_out;
+  EXPECT_TRUE(VectorFromVmo(std::move(sb), &v_out));
+  EXPECT_EQ(v, v_out);
+}
+
 }  // namespace
 }  // namespace mtl
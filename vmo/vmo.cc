@@ -4,33 +4,125 @@
 
 #include "lib/mtl/vmo/strings.h"
 #include "lib/mtl/vmo/vector.h"
+#include "lib/mtl/vmo/vmo.h"
+#include "lib/mtl/vmo/vmo_pool.h"
 
 #include <magenta/syscalls.h>
+#include <mx/vmar.h>
+#include <string.h>
+
 #include <vector>
 
 #include "lib/ftl/logging.h"
+#include "lib/ftl/macros.h"
 
 namespace mtl {
 
 namespace {
 
-template <typename Container>
-bool VmoFromContainer(const Container& container, mx::vmo* handle_ptr) {
-  FTL_CHECK(handle_ptr);
+// Payloads of at least this size are copied through a mapping of the VMO.
+// Below it, the cost of mapping and unmapping outweighs avoiding the extra
+// pass over the data.
+constexpr uint64_t kMapThreshold = 64 * 1024;
+
+// Maps a VMO for the lifetime of this object.
+class ScopedMapping {
+ public:
+  ScopedMapping() = default;
+
+  ~ScopedMapping() {
+    if (address_) {
+      mx_status_t status = mx::vmar::root_self().unmap(address_, size_);
+      FTL_DCHECK(status == MX_OK);
+    }
+  }
 
-  uint64_t num_bytes = container.size();
-  mx_status_t status = mx::vmo::create(num_bytes, 0u, handle_ptr);
+  mx_status_t Map(const mx::vmo& vmo, uint64_t size, uint32_t flags) {
+    FTL_DCHECK(!address_);
+    mx_status_t status =
+        mx::vmar::root_self().map(0, vmo, 0u, size, flags, &address_);
+    if (status != MX_OK)
+      return status;
+    size_ = size;
+    return MX_OK;
+  }
+
+  void* data() const { return reinterpret_cast<void*>(address_); }
+
+ private:
+  uintptr_t address_ = 0u;
+  uint64_t size_ = 0u;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(ScopedMapping);
+};
+
+// Creates a VMO of |num_bytes| whose first |num_bytes| the caller will
+// overwrite, taking it from |pool| if not null. Pooled VMOs come back with the
+// rest of their last page zeroed, so no earlier payload is shared.
+bool CreateVmo(uint64_t num_bytes, VmoPool* pool, mx::vmo* vmo_ptr) {
+  if (pool)
+    return pool->Acquire(num_bytes, VmoPool::Contents::kUninitialized, vmo_ptr);
+
+  mx_status_t status = mx::vmo::create(num_bytes, 0u, vmo_ptr);
   if (status < 0) {
     FTL_LOG(WARNING) << "mx::vmo::create failed: " << status;
     return false;
   }
+  return true;
+}
+
+bool FillNewVmo(uint64_t num_bytes,
+                VmoPool* pool,
+                const std::function<bool(void* data)>& fill,
+                mx::vmo* handle_ptr) {
+  FTL_DCHECK(fill);
+
+  mx::vmo vmo;
+  if (!CreateVmo(num_bytes, pool, &vmo))
+    return false;
+
+  if (num_bytes) {
+    ScopedMapping mapping;
+    mx_status_t status = mapping.Map(
+        vmo, num_bytes, MX_VM_FLAG_PERM_READ | MX_VM_FLAG_PERM_WRITE);
+    if (status != MX_OK) {
+      FTL_LOG(WARNING) << "mx::vmar::map failed: " << status;
+      return false;
+    }
+    if (!fill(mapping.data()))
+      return false;
+  }
+
+  *handle_ptr = std::move(vmo);
+  return true;
+}
+
+template <typename Container>
+bool VmoFromContainer(const Container& container,
+                      VmoPool* pool,
+                      mx::vmo* handle_ptr) {
+  FTL_CHECK(handle_ptr);
+
+  uint64_t num_bytes = container.size();
+  if (num_bytes >= kMapThreshold) {
+    return FillNewVmo(num_bytes, pool,
+                      [&container, num_bytes](void* data) {
+                        memcpy(data, container.data(), num_bytes);
+                        return true;
+                      },
+                      handle_ptr);
+  }
+
+  if (!CreateVmo(num_bytes, pool, handle_ptr))
+    return false;
 
   if (num_bytes == 0) {
     return true;
   }
 
   size_t actual;
-  status = handle_ptr->write(container.data(), 0, num_bytes, &actual);
+  mx_status_t status =
+      handle_ptr->write(container.data(), 0, num_bytes, &actual);
   if (status < 0) {
     FTL_LOG(WARNING) << "mx::vmo::write failed: " << status;
     return false;
@@ -55,6 +147,19 @@ bool ContainerFromVmo(const mx::vmo& buffer, Container* container_ptr) {
     return false;
   }
 
+  if (num_bytes >= kMapThreshold) {
+    // Assigning from the mapping copies the contents once, whereas resizing
+    // then reading would first zero-fill the container. Handles without
+    // MX_RIGHT_MAP cannot be mapped, so those fall through to read().
+    ScopedMapping mapping;
+    if (mapping.Map(buffer, num_bytes, MX_VM_FLAG_PERM_READ) == MX_OK) {
+      const auto* begin =
+          static_cast<const typename Container::value_type*>(mapping.data());
+      container_ptr->assign(begin, begin + num_bytes);
+      return true;
+    }
+  }
+
   container_ptr->resize(num_bytes);
 
   if (num_bytes == 0) {
@@ -79,8 +184,22 @@ bool ContainerFromVmo(const mx::vmo& buffer, Container* container_ptr) {
 
 }  // namespace
 
+bool VmoFromCallback(uint64_t num_bytes,
+                     const std::function<bool(void* data)>& fill,
+                     mx::vmo* handle_ptr) {
+  FTL_CHECK(handle_ptr);
+  return FillNewVmo(num_bytes, nullptr, fill, handle_ptr);
+}
+
 bool VmoFromString(const ftl::StringView& string, mx::vmo* handle_ptr) {
-  return VmoFromContainer<ftl::StringView>(string, handle_ptr);
+  return VmoFromContainer<ftl::StringView>(string, nullptr, handle_ptr);
+}
+
+bool VmoFromString(const ftl::StringView& string,
+                   VmoPool* pool,
+                   mx::vmo* handle_ptr) {
+  FTL_DCHECK(pool);
+  return VmoFromContainer<ftl::StringView>(string, pool, handle_ptr);
 }
 
 bool StringFromVmo(const mx::vmo& shared_buffer, std::string* string_ptr) {
@@ -88,7 +207,14 @@ bool StringFromVmo(const mx::vmo& shared_buffer, std::string* string_ptr) {
 }
 
 bool VmoFromVector(const std::vector<char>& vector, mx::vmo* handle_ptr) {
-  return VmoFromContainer<std::vector<char>>(vector, handle_ptr);
+  return VmoFromContainer<std::vector<char>>(vector, nullptr, handle_ptr);
+}
+
+bool VmoFromVector(const std::vector<char>& vector,
+                   VmoPool* pool,
+                   mx::vmo* handle_ptr) {
+  FTL_DCHECK(pool);
+  return VmoFromContainer<std::vector<char>>(vector, pool, handle_ptr);
 }
 
 bool VectorFromVmo(const mx::vmo& shared_buffer,
@@ -97,7 +223,14 @@ bool VectorFromVmo(const mx::vmo& shared_buffer,
 }
 
 bool VmoFromVector(const std::vector<uint8_t>& vector, mx::vmo* handle_ptr) {
-  return VmoFromContainer<std::vector<uint8_t>>(vector, handle_ptr);
+  return VmoFromContainer<std::vector<uint8_t>>(vector, nullptr, handle_ptr);
+}
+
+bool VmoFromVector(const std::vector<uint8_t>& vector,
+                   VmoPool* pool,
+                   mx::vmo* handle_ptr) {
+  FTL_DCHECK(pool);
+  return VmoFromContainer<std::vector<uint8_t>>(vector, pool, handle_ptr);
 }
 
 bool VectorFromVmo(const mx::vmo& shared_buffer,
@@ -0,0 +1,27 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_MTL_VMO_VMO_H_
+#define LIB_MTL_VMO_VMO_H_
+
+#include <mx/vmo.h>
+
+#include <functional>
+
+#include "lib/ftl/ftl_export.h"
+
+namespace mtl {
+
+// Make a new shared buffer of |num_bytes| and let |fill| write its contents
+// directly through a writable mapping, without an intermediate copy.
+//
+// |fill| receives the address of the mapping, which is only valid for the
+// duration of the call, and returns false to abandon the buffer.
+FTL_EXPORT bool VmoFromCallback(uint64_t num_bytes,
+                                const std::function<bool(void* data)>& fill,
+                                mx::vmo* handle_ptr);
+
+}  // namespace mtl
+
+#endif  // LIB_MTL_VMO_VMO_H_
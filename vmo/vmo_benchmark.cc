@@ -0,0 +1,277 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <mx/vmo.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lib/mtl/test/benchmark.h"
+#include "lib/mtl/threading/loop_group.h"
+#include "lib/mtl/vmo/parallel_copy.h"
+#include "lib/mtl/vmo/shared_vmo.h"
+#include "lib/mtl/vmo/strings.h"
+#include "lib/mtl/vmo/vector.h"
+#include "lib/mtl/vmo/vmo.h"
+#include "lib/mtl/vmo/vmo_pool.h"
+
+namespace mtl {
+namespace {
+
+using benchmark::State;
+
+constexpr int64_t kKilobyte = 1024;
+constexpr int64_t kMegabyte = 1024 * kKilobyte;
+
+#define VMO_SIZES 4 * kKilobyte, 64 * kKilobyte, kMegabyte, 16 * kMegabyte
+
+// The copy-through-syscall implementation which was used for every size
+// before mapped copies, kept as a baseline.
+bool LegacyVmoFromString(const std::string& string, mx::vmo* vmo) {
+  if (mx::vmo::create(string.size(), 0u, vmo) != MX_OK)
+    return false;
+  size_t actual;
+  return vmo->write(string.data(), 0, string.size(), &actual) == MX_OK &&
+         actual == string.size();
+}
+
+bool LegacyStringFromVmo(const mx::vmo& vmo, std::string* string) {
+  uint64_t num_bytes;
+  if (vmo.get_size(&num_bytes) != MX_OK)
+    return false;
+  string->resize(num_bytes);
+  size_t actual;
+  return vmo.read(&(*string)[0], 0, num_bytes, &actual) == MX_OK &&
+         actual == num_bytes;
+}
+
+void LegacyVmoFromStringThroughput(State* state) {
+  const std::string data(state->range(), 'x');
+  while (state->KeepRunning()) {
+    mx::vmo vmo;
+    if (!LegacyVmoFromString(data, &vmo)) {
+      state->SkipWithError("LegacyVmoFromString failed");
+      break;
+    }
+  }
+  state->SetBytesProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(LegacyVmoFromStringThroughput, VMO_SIZES);
+
+void LegacyStringFromVmoThroughput(State* state) {
+  mx::vmo vmo;
+  if (!LegacyVmoFromString(std::string(state->range(), 'x'), &vmo)) {
+    state->SkipWithError("LegacyVmoFromString failed");
+    return;
+  }
+  while (state->KeepRunning()) {
+    std::string data;
+    if (!LegacyStringFromVmo(vmo, &data)) {
+      state->SkipWithError("LegacyStringFromVmo failed");
+      break;
+    }
+  }
+  state->SetBytesProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(LegacyStringFromVmoThroughput, VMO_SIZES);
+
+// Produces the contents in place, as a serializer writing straight into the
+// VMO would, so there is no source buffer to copy from.
+void VmoFromCallbackThroughput(State* state) {
+  const size_t size = state->range();
+  while (state->KeepRunning()) {
+    mx::vmo vmo;
+    if (!VmoFromCallback(size,
+                         [size](void* data) {
+                           memset(data, 'x', size);
+                           return true;
+                         },
+                         &vmo)) {
+      state->SkipWithError("VmoFromCallback failed");
+      break;
+    }
+  }
+  state->SetBytesProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(VmoFromCallbackThroughput, VMO_SIZES);
+
+void VmoFromStringThroughput(State* state) {
+  const std::string data(state->range(), 'x');
+  while (state->KeepRunning()) {
+    mx::vmo vmo;
+    if (!VmoFromString(data, &vmo)) {
+      state->SkipWithError("VmoFromString failed");
+      break;
+    }
+  }
+  state->SetBytesProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(VmoFromStringThroughput, VMO_SIZES);
+
+void StringFromVmoThroughput(State* state) {
+  mx::vmo vmo;
+  if (!VmoFromString(std::string(state->range(), 'x'), &vmo)) {
+    state->SkipWithError("VmoFromString failed");
+    return;
+  }
+  while (state->KeepRunning()) {
+    std::string data;
+    if (!StringFromVmo(vmo, &data)) {
+      state->SkipWithError("StringFromVmo failed");
+      break;
+    }
+  }
+  state->SetBytesProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(StringFromVmoThroughput, VMO_SIZES);
+
+void VmoFromVectorThroughput(State* state) {
+  const std::vector<uint8_t> data(state->range(), 'x');
+  while (state->KeepRunning()) {
+    mx::vmo vmo;
+    if (!VmoFromVector(data, &vmo)) {
+      state->SkipWithError("VmoFromVector failed");
+      break;
+    }
+  }
+  state->SetBytesProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(VmoFromVectorThroughput, VMO_SIZES);
+
+void VectorFromVmoThroughput(State* state) {
+  mx::vmo vmo;
+  if (!VmoFromVector(std::vector<uint8_t>(state->range(), 'x'), &vmo)) {
+    state->SkipWithError("VmoFromVector failed");
+    return;
+  }
+  while (state->KeepRunning()) {
+    std::vector<uint8_t> data;
+    if (!VectorFromVmo(vmo, &data)) {
+      state->SkipWithError("VectorFromVmo failed");
+      break;
+    }
+  }
+  state->SetBytesProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(VectorFromVmoThroughput, VMO_SIZES);
+
+// Like |VmoFromStringThroughput| but recycles each VMO through a pool, as a
+// service which creates many short-lived buffers would.
+void PooledVmoFromStringThroughput(State* state) {
+  const std::string data(state->range(), 'x');
+  VmoPool pool;
+  while (state->KeepRunning()) {
+    mx::vmo vmo;
+    if (!VmoFromString(data, &pool, &vmo)) {
+      state->SkipWithError("VmoFromString failed");
+      break;
+    }
+    pool.Recycle(std::move(vmo));
+  }
+  state->SetBytesProcessed(state->iterations() * state->range());
+}
+MTL_BENCHMARK_RANGES(PooledVmoFromStringThroughput, VMO_SIZES);
+
+#define PARALLEL_COPY_SIZES \
+  256 * kKilobyte, kMegabyte, 4 * kMegabyte, 16 * kMegabyte, 64 * kMegabyte
+
+// Writes with |ParallelVmoWrite| using |worker_count| extra threads, or
+// serially when zero. Comparing the two at each size shows where splitting
+// the copy starts to pay off, which should guide
+// |kDefaultParallelCopyThreshold|.
+void ParallelVmoWriteThroughput(State* state, size_t worker_count) {
+  const std::string data(state->range(), 'x');
+  mx::vmo vmo;
+  if (mx::vmo::create(data.size(), 0u, &vmo) != MX_OK) {
+    state->SkipWithError("mx::vmo::create failed");
+    return;
+  }
+  std::unique_ptr<LoopGroup> group;
+  std::vector<ftl::RefPtr<ftl::TaskRunner>> workers;
+  if (worker_count) {
+    group = std::make_unique<LoopGroup>(worker_count);
+    for (size_t i = 0; i < worker_count; i++)
+      workers.push_back(group->task_runner(i));
+  }
+  while (state->KeepRunning()) {
+    if (!ParallelVmoWrite(vmo, 0u, data.data(), data.size(), workers, 0u)) {
+      state->SkipWithError("ParallelVmoWrite failed");
+      break;
+    }
+  }
+  state->SetBytesProcessed(state->iterations() * state->range());
+}
+
+void SerialVmoWrite(State* state) {
+  ParallelVmoWriteThroughput(state, 0u);
+}
+MTL_BENCHMARK_RANGES(SerialVmoWrite, PARALLEL_COPY_SIZES);
+
+void ParallelVmoWrite2Workers(State* state) {
+  ParallelVmoWriteThroughput(state, 2u);
+}
+MTL_BENCHMARK_RANGES(ParallelVmoWrite2Workers, PARALLEL_COPY_SIZES);
+
+void ParallelVmoWrite4Workers(State* state) {
+  ParallelVmoWriteThroughput(state, 4u);
+}
+MTL_BENCHMARK_RANGES(ParallelVmoWrite4Workers, PARALLEL_COPY_SIZES);
+
+void ParallelVmoReadThroughput(State* state, size_t worker_count) {
+  mx::vmo vmo;
+  if (!VmoFromString(std::string(state->range(), 'x'), &vmo)) {
+    state->SkipWithError("VmoFromString failed");
+    return;
+  }
+  std::string data(state->range(), '\0');
+  std::unique_ptr<LoopGroup> group;
+  std::vector<ftl::RefPtr<ftl::TaskRunner>> workers;
+  if (worker_count) {
+    group = std::make_unique<LoopGroup>(worker_count);
+    for (size_t i = 0; i < worker_count; i++)
+      workers.push_back(group->task_runner(i));
+  }
+  while (state->KeepRunning()) {
+    if (!ParallelVmoRead(vmo, 0u, &data[0], data.size(), workers, 0u)) {
+      state->SkipWithError("ParallelVmoRead failed");
+      break;
+    }
+  }
+  state->SetBytesProcessed(state->iterations() * state->range());
+}
+
+void SerialVmoRead(State* state) {
+  ParallelVmoReadThroughput(state, 0u);
+}
+MTL_BENCHMARK_RANGES(SerialVmoRead, PARALLEL_COPY_SIZES);
+
+void ParallelVmoRead4Workers(State* state) {
+  ParallelVmoReadThroughput(state, 4u);
+}
+MTL_BENCHMARK_RANGES(ParallelVmoRead4Workers, PARALLEL_COPY_SIZES);
+
+// Measures |SharedVmo::Map| once the VMO has been mapped, as seen by readers
+// on hot paths.
+void SharedVmoMapMapped(State* state) {
+  mx::vmo vmo;
+  if (!VmoFromString(std::string(4 * kKilobyte, 'x'), &vmo)) {
+    state->SkipWithError("VmoFromString failed");
+    return;
+  }
+  auto shared_vmo = ftl::MakeRefCounted<SharedVmo>(
+      std::move(vmo), MX_VM_FLAG_PERM_READ, SharedVmo::MapTiming::kEager);
+  while (state->KeepRunning()) {
+    if (!shared_vmo->Map()) {
+      state->SkipWithError("SharedVmo::Map failed");
+      break;
+    }
+  }
+  state->SetItemsProcessed(state->iterations());
+}
+MTL_BENCHMARK(SharedVmoMapMapped);
+
+}  // namespace
+}  // namespace mtl
@@ -0,0 +1,163 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/vmo/vmo_buffer.h"
+
+#include <mx/vmar.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "lib/ftl/logging.h"
+
+namespace mtl {
+namespace {
+
+constexpr size_t kPageSize = 4096u;
+
+size_t RoundUpToPage(size_t size) {
+  return (size + kPageSize - 1u) & ~(kPageSize - 1u);
+}
+
+}  // namespace
+
+VmoBuffer::VmoBuffer() = default;
+
+VmoBuffer::~VmoBuffer() {
+  Unmap();
+}
+
+VmoBuffer::VmoBuffer(VmoBuffer&& other)
+    : vmo_(std::move(other.vmo_)),
+      mapping_(other.mapping_),
+      size_(other.size_),
+      capacity_(other.capacity_) {
+  other.mapping_ = 0u;
+  other.size_ = 0u;
+  other.capacity_ = 0u;
+}
+
+VmoBuffer& VmoBuffer::operator=(VmoBuffer&& other) {
+  if (this != &other) {
+    Unmap();
+    vmo_ = std::move(other.vmo_);
+    mapping_ = other.mapping_;
+    size_ = other.size_;
+    capacity_ = other.capacity_;
+    other.mapping_ = 0u;
+    other.size_ = 0u;
+    other.capacity_ = 0u;
+  }
+  return *this;
+}
+
+bool VmoBuffer::Reserve(size_t capacity) {
+  if (capacity <= capacity_)
+    return true;
+
+  // Grow geometrically so that a sequence of appends is amortized linear.
+  return ReserveExact(std::max(capacity, capacity_ * 2u));
+}
+
+bool VmoBuffer::ReserveExact(size_t capacity) {
+  if (capacity <= capacity_)
+    return true;
+
+  size_t new_capacity = RoundUpToPage(capacity);
+
+  mx_status_t status;
+  if (vmo_) {
+    status = vmo_.set_size(new_capacity);
+    if (status != MX_OK) {
+      FTL_LOG(WARNING) << "mx::vmo::set_size failed: " << status;
+      return false;
+    }
+  } else {
+    status = mx::vmo::create(new_capacity, 0u, &vmo_);
+    if (status != MX_OK) {
+      FTL_LOG(WARNING) << "mx::vmo::create failed: " << status;
+      return false;
+    }
+  }
+
+  // The pages are shared with the VMO, so remapping does not copy contents.
+  uintptr_t new_mapping = 0u;
+  status = mx::vmar::root_self().map(
+      0, vmo_, 0u, new_capacity, MX_VM_FLAG_PERM_READ | MX_VM_FLAG_PERM_WRITE,
+      &new_mapping);
+  if (status != MX_OK) {
+    FTL_LOG(WARNING) << "mx::vmar::map failed: " << status;
+    if (capacity_)
+      vmo_.set_size(capacity_);
+    else
+      vmo_.reset();
+    return false;
+  }
+
+  Unmap();
+  mapping_ = new_mapping;
+  capacity_ = new_capacity;
+  return true;
+}
+
+bool VmoBuffer::Resize(size_t size) {
+  if (size > size_) {
+    if (!Reserve(size))
+      return false;
+    // Pages past the old size may hold stale bytes from before a |Clear|.
+    memset(data() + size_, 0, size - size_);
+  }
+  size_ = size;
+  return true;
+}
+
+bool VmoBuffer::Append(const void* data, size_t size) {
+  if (!size)
+    return true;
+  if (!Reserve(size_ + size))
+    return false;
+  memcpy(this->data() + size_, data, size);
+  size_ += size;
+  return true;
+}
+
+bool VmoBuffer::Release(mx::vmo* vmo_ptr) {
+  FTL_DCHECK(vmo_ptr);
+
+  if (!vmo_) {
+    mx_status_t status = mx::vmo::create(0u, 0u, vmo_ptr);
+    if (status != MX_OK) {
+      FTL_LOG(WARNING) << "mx::vmo::create failed: " << status;
+      return false;
+    }
+    return true;
+  }
+
+  // VMO sizes are whole pages, so the rest of the last page goes out with
+  // the VMO. It may hold stale bytes from before a |Clear|.
+  memset(data() + size_, 0, RoundUpToPage(size_) - size_);
+
+  mx_status_t status = vmo_.set_size(size_);
+  if (status != MX_OK) {
+    FTL_LOG(WARNING) << "mx::vmo::set_size failed: " << status;
+    return false;
+  }
+
+  Unmap();
+  *vmo_ptr = std::move(vmo_);
+  size_ = 0u;
+  capacity_ = 0u;
+  return true;
+}
+
+void VmoBuffer::Unmap() {
+  if (mapping_) {
+    mx_status_t status = mx::vmar::root_self().unmap(mapping_, capacity_);
+    FTL_CHECK(status == MX_OK);
+    mapping_ = 0u;
+  }
+}
+
+}  // namespace mtl
@@ -0,0 +1,90 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_MTL_VMO_VMO_BUFFER_H_
+#define LIB_MTL_VMO_VMO_BUFFER_H_
+
+#include <mx/vmo.h>
+#include <stdint.h>
+
+#include "lib/ftl/ftl_export.h"
+#include "lib/ftl/logging.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/strings/string_view.h"
+
+namespace mtl {
+
+// A growable byte buffer which lives in a memory-mapped VMO.
+//
+// Use it to build payloads which are destined for another process: once the
+// contents are complete, |Release| hands off the VMO without copying them.
+//
+// Like |std::vector|, growing the buffer beyond its capacity invalidates
+// pointers previously returned by |data|.
+//
+// This object is not thread-safe.
+class FTL_EXPORT VmoBuffer {
+ public:
+  VmoBuffer();
+  ~VmoBuffer();
+
+  VmoBuffer(VmoBuffer&& other);
+  VmoBuffer& operator=(VmoBuffer&& other);
+
+  uint8_t* data() { return reinterpret_cast<uint8_t*>(mapping_); }
+  const uint8_t* data() const {
+    return reinterpret_cast<const uint8_t*>(mapping_);
+  }
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0u; }
+
+  // Ensures the buffer can hold at least |capacity| bytes without growing.
+  // Returns false if the VMO could not be resized or remapped, in which case
+  // the buffer is left unchanged.
+  bool Reserve(size_t capacity);
+
+  // Like |Reserve|, but grows the capacity only to |capacity| rounded up to a
+  // whole page rather than geometrically, for callers which choose their own
+  // growth policy.
+  bool ReserveExact(size_t capacity);
+
+  // Changes the size of the buffer. Bytes added at the end are zeroed.
+  bool Resize(size_t size);
+
+  // Appends |size| bytes from |data|.
+  bool Append(const void* data, size_t size);
+  bool Append(ftl::StringView data) { return Append(data.data(), data.size()); }
+
+  // Grows the size by |count| bytes which the caller has already written into
+  // the spare capacity past |size()|, for example with |read|. Bytes up to
+  // |capacity()| may be written through |data()|.
+  void Commit(size_t count) {
+    FTL_DCHECK(count <= capacity_ - size_);
+    size_ += count;
+  }
+
+  // Sets the size to zero, keeping the capacity.
+  void Clear() { size_ = 0u; }
+
+  // Trims the VMO to the size of the buffer and moves it to |vmo_ptr|. The
+  // buffer is left empty. Returns false if the VMO could not be resized, in
+  // which case the buffer is left unchanged.
+  bool Release(mx::vmo* vmo_ptr);
+
+ private:
+  void Unmap();
+
+  mx::vmo vmo_;
+  uintptr_t mapping_ = 0u;
+  size_t size_ = 0u;
+  size_t capacity_ = 0u;
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(VmoBuffer);
+};
+
+}  // namespace mtl
+
+#endif  // LIB_MTL_VMO_VMO_BUFFER_H_
@@ -0,0 +1,128 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/vmo/vmo_buffer.h"
+
+#include <mx/vmar.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/mtl/vmo/strings.h"
+
+namespace mtl {
+namespace {
+
+TEST(VmoBuffer, Empty) {
+  VmoBuffer buffer;
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(0u, buffer.capacity());
+
+  mx::vmo vmo;
+  EXPECT_TRUE(buffer.Release(&vmo));
+  std::string out;
+  EXPECT_TRUE(StringFromVmo(vmo, &out));
+  EXPECT_EQ("", out);
+}
+
+TEST(VmoBuffer, AppendAndRelease) {
+  VmoBuffer buffer;
+  EXPECT_TRUE(buffer.Append("Hello, "));
+  EXPECT_TRUE(buffer.Append("world."));
+  EXPECT_EQ(13u, buffer.size());
+  EXPECT_EQ("Hello, world.",
+            std::string(reinterpret_cast<const char*>(buffer.data()),
+                        buffer.size()));
+
+  mx::vmo vmo;
+  EXPECT_TRUE(buffer.Release(&vmo));
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(0u, buffer.capacity());
+
+  std::string out;
+  EXPECT_TRUE(StringFromVmo(vmo, &out));
+  EXPECT_EQ("Hello, world.", out);
+}
+
+TEST(VmoBuffer, GrowKeepsContents) {
+  VmoBuffer buffer;
+  std::string expected;
+  for (size_t i = 0; i < 10000u; i++) {
+    std::string chunk = std::to_string(i);
+    ASSERT_TRUE(buffer.Append(chunk));
+    expected += chunk;
+  }
+  EXPECT_GE(buffer.capacity(), buffer.size());
+
+  mx::vmo vmo;
+  EXPECT_TRUE(buffer.Release(&vmo));
+  std::string out;
+  EXPECT_TRUE(StringFromVmo(vmo, &out));
+  EXPECT_EQ(expected, out);
+}
+
+TEST(VmoBuffer, Reserve) {
+  VmoBuffer buffer;
+  EXPECT_TRUE(buffer.Reserve(100000u));
+  EXPECT_GE(buffer.capacity(), 100000u);
+  EXPECT_EQ(0u, buffer.size());
+
+  const uint8_t* data = buffer.data();
+  EXPECT_TRUE(buffer.Append("abc"));
+  EXPECT_EQ(data, buffer.data());
+}
+
+TEST(VmoBuffer, ReserveExact) {
+  VmoBuffer buffer;
+  EXPECT_TRUE(buffer.ReserveExact(4096u));
+  EXPECT_EQ(4096u, buffer.capacity());
+  EXPECT_TRUE(buffer.ReserveExact(4097u));
+  EXPECT_EQ(8192u, buffer.capacity());
+  EXPECT_TRUE(buffer.ReserveExact(100u));
+  EXPECT_EQ(8192u, buffer.capacity());
+}
+
+TEST(VmoBuffer, ResizeZeroesNewBytes) {
+  VmoBuffer buffer;
+  EXPECT_TRUE(buffer.Append("abcdef"));
+  buffer.Clear();
+  EXPECT_TRUE(buffer.Resize(4u));
+  EXPECT_EQ(std::string(4u, '\0'),
+            std::string(reinterpret_cast<const char*>(buffer.data()),
+                        buffer.size()));
+}
+
+TEST(VmoBuffer, Move) {
+  VmoBuffer buffer;
+  EXPECT_TRUE(buffer.Append("abc"));
+  VmoBuffer other(std::move(buffer));
+  EXPECT_EQ(0u, buffer.size());
+  EXPECT_EQ(3u, other.size());
+
+  buffer = std::move(other);
+  EXPECT_EQ(3u, buffer.size());
+  EXPECT_EQ('a', buffer.data()[0]);
+}
+
+TEST(VmoBuffer, ReleaseAfterClearZeroesPageTail) {
+  VmoBuffer buffer;
+  EXPECT_TRUE(buffer.Append(std::string(4096u, '\xff')));
+  buffer.Clear();
+  EXPECT_TRUE(buffer.Append("0123456789"));
+
+  mx::vmo vmo;
+  EXPECT_TRUE(buffer.Release(&vmo));
+
+  // A receiver which maps the whole page must not see the cleared contents.
+  uintptr_t address = 0u;
+  ASSERT_EQ(MX_OK, mx::vmar::root_self().map(0u, vmo, 0u, 4096u,
+                                             MX_VM_FLAG_PERM_READ, &address));
+  const char* data = reinterpret_cast<const char*>(address);
+  EXPECT_EQ("0123456789", std::string(data, 10u));
+  EXPECT_EQ(std::string(4086u, '\0'), std::string(data + 10u, 4086u));
+  EXPECT_EQ(MX_OK, mx::vmar::root_self().unmap(address, 4096u));
+}
+
+}  // namespace
+}  // namespace mtl
@@ -0,0 +1,144 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/vmo/vmo_cache.h"
+
+#include <string.h>
+
+#include <iterator>
+#include <utility>
+
+#include "lib/ftl/logging.h"
+#include "lib/mtl/vmo/strings.h"
+
+namespace mtl {
+namespace {
+
+constexpr size_t kPageSize = 4096u;
+
+// Rights of the handles given out, which do not allow modifying the shared
+// contents.
+constexpr mx_rights_t kReadOnlyRights = MX_RIGHT_DUPLICATE |
+                                        MX_RIGHT_TRANSFER | MX_RIGHT_READ |
+                                        MX_RIGHT_MAP | MX_RIGHT_GET_PROPERTY;
+
+size_t PageRoundedSize(size_t size) {
+  return (size + kPageSize - 1u) & ~(kPageSize - 1u);
+}
+
+// 64-bit FNV-1a.
+uint64_t HashData(ftl::StringView data) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : data) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+}  // namespace
+
+VmoCache::VmoCache(size_t memory_budget) : memory_budget_(memory_budget) {}
+
+VmoCache::~VmoCache() {}
+
+bool VmoCache::GetVmo(ftl::StringView data, mx::vmo* handle_ptr) {
+  FTL_DCHECK(handle_ptr);
+
+  const uint64_t hash = HashData(data);
+  const size_t cost = PageRoundedSize(data.size());
+  ftl::RefPtr<SharedVmo> shared_vmo;
+  {
+    ftl::MutexLocker locker(&mutex_);
+    shared_vmo = Find(hash, data);
+    if (shared_vmo)
+      stats_.hits++;
+    else
+      stats_.misses++;
+  }
+
+  if (!shared_vmo) {
+    mx::vmo vmo;
+    if (!VmoFromString(data, &vmo))
+      return false;
+    if (cost > memory_budget_)
+      return vmo.replace(kReadOnlyRights, handle_ptr) == MX_OK;
+
+    shared_vmo =
+        ftl::MakeRefCounted<SharedVmo>(std::move(vmo), MX_VM_FLAG_PERM_READ);
+
+    ftl::MutexLocker locker(&mutex_);
+    // Another thread may have added the same payload in the meantime.
+    ftl::RefPtr<SharedVmo> existing = Find(hash, data);
+    if (existing) {
+      shared_vmo = std::move(existing);
+    } else {
+      entries_.push_front(Entry{hash, shared_vmo});
+      index_.emplace(hash, entries_.begin());
+      memory_used_ += cost;
+      EvictUntilWithinBudget();
+    }
+  }
+
+  mx_status_t status = shared_vmo->vmo().duplicate(kReadOnlyRights, handle_ptr);
+  if (status != MX_OK) {
+    FTL_LOG(WARNING) << "mx::vmo::duplicate failed: " << status;
+    return false;
+  }
+  return true;
+}
+
+void VmoCache::Clear() {
+  ftl::MutexLocker locker(&mutex_);
+  entries_.clear();
+  index_.clear();
+  memory_used_ = 0u;
+}
+
+size_t VmoCache::memory_used() const {
+  ftl::MutexLocker locker(&mutex_);
+  return memory_used_;
+}
+
+VmoCache::Stats VmoCache::stats() const {
+  ftl::MutexLocker locker(&mutex_);
+  return stats_;
+}
+
+ftl::RefPtr<SharedVmo> VmoCache::Find(uint64_t hash, ftl::StringView data) {
+  auto range = index_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    EntryList::iterator entry = it->second;
+    const SharedVmo* shared_vmo = entry->shared_vmo.get();
+    if (shared_vmo->vmo_size() != data.size())
+      continue;
+    if (data.size()) {
+      // The mapping is set up once and kept for later comparisons.
+      const void* contents = entry->shared_vmo->Map();
+      if (!contents || memcmp(contents, data.data(), data.size()) != 0)
+        continue;
+    }
+    entries_.splice(entries_.begin(), entries_, entry);
+    return entries_.front().shared_vmo;
+  }
+  return nullptr;
+}
+
+void VmoCache::EvictUntilWithinBudget() {
+  while (memory_used_ > memory_budget_ && !entries_.empty()) {
+    const Entry& entry = entries_.back();
+    auto range = index_.equal_range(entry.hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == std::prev(entries_.end())) {
+        index_.erase(it);
+        break;
+      }
+    }
+    memory_used_ -= PageRoundedSize(entry.shared_vmo->vmo_size());
+    entries_.pop_back();
+    stats_.evictions++;
+  }
+}
+
+}  // namespace mtl
@@ -0,0 +1,87 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_MTL_VMO_VMO_CACHE_H_
+#define LIB_MTL_VMO_VMO_CACHE_H_
+
+#include <mx/vmo.h>
+
+#include <list>
+#include <unordered_map>
+
+#include "lib/ftl/ftl_export.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/memory/ref_ptr.h"
+#include "lib/ftl/strings/string_view.h"
+#include "lib/ftl/synchronization/mutex.h"
+#include "lib/ftl/synchronization/thread_annotations.h"
+#include "lib/mtl/vmo/shared_vmo.h"
+
+namespace mtl {
+
+// Deduplicates VMOs made from identical payloads.
+//
+// Looks up payloads by a hash of their contents, confirmed by comparing the
+// bytes, and hands out read-only duplicates of a single VMO per payload. This
+// saves both the copy and the memory when the same data is sent repeatedly.
+//
+// The cache holds on to VMOs whose total size fits in a memory budget,
+// evicting the least recently used ones first. Evicted VMOs remain valid for
+// whoever holds handles to them.
+//
+// This object is thread-safe.
+class FTL_EXPORT VmoCache {
+ public:
+  struct Stats {
+    // Payloads served from an existing VMO.
+    uint64_t hits = 0u;
+    // Payloads copied into a new VMO.
+    uint64_t misses = 0u;
+    // VMOs dropped from the cache to stay within budget.
+    uint64_t evictions = 0u;
+  };
+
+  // |memory_budget| bounds the total size, rounded to pages, of the VMOs
+  // held by the cache. Payloads larger than the budget are never cached.
+  explicit VmoCache(size_t memory_budget);
+  ~VmoCache();
+
+  // Sets |handle_ptr| to a read-only VMO with the contents of |data|, reusing
+  // a cached VMO if one has identical contents.
+  bool GetVmo(ftl::StringView data, mx::vmo* handle_ptr);
+
+  // Drops all cached VMOs.
+  void Clear();
+
+  size_t memory_used() const;
+  Stats stats() const;
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    ftl::RefPtr<SharedVmo> shared_vmo;
+  };
+  using EntryList = std::list<Entry>;
+
+  // Returns a cached VMO with the contents of |data|, or nullptr.
+  ftl::RefPtr<SharedVmo> Find(uint64_t hash, ftl::StringView data)
+      FTL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void EvictUntilWithinBudget() FTL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const size_t memory_budget_;
+
+  mutable ftl::Mutex mutex_;
+  // Most recently used first.
+  EntryList entries_ FTL_GUARDED_BY(mutex_);
+  std::unordered_multimap<uint64_t, EntryList::iterator> index_
+      FTL_GUARDED_BY(mutex_);
+  size_t memory_used_ FTL_GUARDED_BY(mutex_) = 0u;
+  Stats stats_ FTL_GUARDED_BY(mutex_);
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(VmoCache);
+};
+
+}  // namespace mtl
+
+#endif  // LIB_MTL_VMO_VMO_CACHE_H_
@@ -0,0 +1,85 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/vmo/vmo_cache.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/mtl/vmo/strings.h"
+
+namespace mtl {
+namespace {
+
+std::string ReadVmo(const mx::vmo& vmo) {
+  std::string content;
+  EXPECT_TRUE(StringFromVmo(vmo, &content));
+  return content;
+}
+
+TEST(VmoCache, DeduplicatesIdenticalContents) {
+  VmoCache cache(1024u * 1024u);
+  mx::vmo first, second, other;
+  ASSERT_TRUE(cache.GetVmo("payload", &first));
+  ASSERT_TRUE(cache.GetVmo(std::string("payload"), &second));
+  ASSERT_TRUE(cache.GetVmo("different", &other));
+
+  EXPECT_EQ("payload", ReadVmo(first));
+  EXPECT_EQ("payload", ReadVmo(second));
+  EXPECT_EQ("different", ReadVmo(other));
+
+  VmoCache::Stats stats = cache.stats();
+  EXPECT_EQ(1u, stats.hits);
+  EXPECT_EQ(2u, stats.misses);
+  EXPECT_EQ(2u * 4096u, cache.memory_used());
+}
+
+TEST(VmoCache, HandlesAreReadOnly) {
+  VmoCache cache(1024u * 1024u);
+  mx::vmo vmo;
+  ASSERT_TRUE(cache.GetVmo("payload", &vmo));
+
+  size_t actual;
+  EXPECT_EQ(MX_ERR_ACCESS_DENIED, vmo.write("x", 0u, 1u, &actual));
+  EXPECT_EQ("payload", ReadVmo(vmo));
+}
+
+TEST(VmoCache, EvictsLeastRecentlyUsed) {
+  VmoCache cache(2u * 4096u);
+  mx::vmo vmo;
+  ASSERT_TRUE(cache.GetVmo("a", &vmo));
+  ASSERT_TRUE(cache.GetVmo("b", &vmo));
+  ASSERT_TRUE(cache.GetVmo("a", &vmo));
+  ASSERT_TRUE(cache.GetVmo("c", &vmo));
+  EXPECT_EQ(1u, cache.stats().evictions);
+  EXPECT_EQ(2u * 4096u, cache.memory_used());
+
+  // "b" was evicted, "a" was not.
+  ASSERT_TRUE(cache.GetVmo("a", &vmo));
+  EXPECT_EQ(2u, cache.stats().hits);
+  ASSERT_TRUE(cache.GetVmo("b", &vmo));
+  EXPECT_EQ(2u, cache.stats().hits);
+  EXPECT_EQ("b", ReadVmo(vmo));
+}
+
+TEST(VmoCache, PayloadLargerThanBudget) {
+  VmoCache cache(4096u);
+  const std::string large(8192u, 'x');
+  mx::vmo vmo;
+  ASSERT_TRUE(cache.GetVmo(large, &vmo));
+  EXPECT_EQ(large, ReadVmo(vmo));
+  EXPECT_EQ(0u, cache.memory_used());
+}
+
+TEST(VmoCache, EmptyPayload) {
+  VmoCache cache(4096u);
+  mx::vmo first, second;
+  ASSERT_TRUE(cache.GetVmo("", &first));
+  ASSERT_TRUE(cache.GetVmo("", &second));
+  EXPECT_EQ("", ReadVmo(second));
+  EXPECT_EQ(1u, cache.stats().hits);
+}
+
+}  // namespace
+}  // namespace mtl
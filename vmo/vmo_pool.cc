@@ -0,0 +1,128 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/vmo/vmo_pool.h"
+
+#include <utility>
+
+#include "lib/ftl/logging.h"
+
+namespace mtl {
+namespace {
+
+constexpr uint64_t kPageSize = 4096u;
+
+uint64_t RoundUpToPage(uint64_t size) {
+  return (size + kPageSize - 1u) & ~(kPageSize - 1u);
+}
+
+// Zeroes the bytes of |vmo| from |size| to the end of its last page.
+mx_status_t ZeroPageTail(const mx::vmo& vmo, uint64_t size) {
+  static const char kZeroes[kPageSize] = {};
+  uint64_t tail = RoundUpToPage(size) - size;
+  if (!tail)
+    return MX_OK;
+  size_t actual = 0u;
+  mx_status_t status = vmo.write(kZeroes, size, tail, &actual);
+  if (status == MX_OK && actual != tail)
+    status = MX_ERR_IO;
+  return status;
+}
+
+// Returns the index of the smallest class which holds |size| bytes.
+// Class |i| holds VMOs of up to |kPageSize << i| bytes.
+size_t ClassForSize(uint64_t size) {
+  size_t index = 0u;
+  while ((kPageSize << index) < size)
+    index++;
+  return index;
+}
+
+}  // namespace
+
+constexpr uint64_t VmoPool::kMaxPooledSize;
+
+VmoPool::VmoPool(size_t max_vmos_per_class)
+    : max_vmos_per_class_(max_vmos_per_class),
+      classes_(ClassForSize(kMaxPooledSize) + 1u) {}
+
+VmoPool::~VmoPool() {}
+
+bool VmoPool::Acquire(uint64_t size, Contents contents, mx::vmo* vmo_ptr) {
+  FTL_DCHECK(vmo_ptr);
+
+  mx::vmo vmo;
+  if (size && size <= kMaxPooledSize) {
+    ftl::MutexLocker locker(&mutex_);
+    auto& idle = classes_[ClassForSize(size)];
+    if (!idle.empty()) {
+      vmo = std::move(idle.back());
+      idle.pop_back();
+    }
+  }
+
+  if (vmo) {
+    // VMO sizes are whole pages, so |set_size| keeps whatever the previous
+    // user left in the rest of the last page. Since the caller only writes
+    // |size| bytes, that tail must be cleared before the VMO is handed out.
+    mx_status_t status = vmo.set_size(size);
+    if (status == MX_OK) {
+      if (contents == Contents::kZeroed) {
+        status = vmo.op_range(MX_VMO_OP_DECOMMIT, 0u, RoundUpToPage(size),
+                              nullptr, 0u);
+      } else {
+        status = ZeroPageTail(vmo, size);
+      }
+    }
+    if (status == MX_OK) {
+      ftl::MutexLocker locker(&mutex_);
+      stats_.hits++;
+      *vmo_ptr = std::move(vmo);
+      return true;
+    }
+    FTL_LOG(WARNING) << "Failed to reuse pooled vmo: " << status;
+  }
+
+  {
+    ftl::MutexLocker locker(&mutex_);
+    stats_.misses++;
+  }
+  mx_status_t status = mx::vmo::create(size, 0u, vmo_ptr);
+  if (status != MX_OK) {
+    FTL_LOG(WARNING) << "mx::vmo::create failed: " << status;
+    return false;
+  }
+  return true;
+}
+
+void VmoPool::Recycle(mx::vmo vmo) {
+  FTL_DCHECK(vmo);
+
+  uint64_t size = 0u;
+  mx_status_t status = vmo.get_size(&size);
+  ftl::MutexLocker locker(&mutex_);
+  if (status != MX_OK || !size || size > kMaxPooledSize) {
+    stats_.discarded++;
+    return;
+  }
+  auto& idle = classes_[ClassForSize(size)];
+  if (idle.size() >= max_vmos_per_class_) {
+    stats_.discarded++;
+    return;
+  }
+  idle.push_back(std::move(vmo));
+}
+
+void VmoPool::Clear() {
+  ftl::MutexLocker locker(&mutex_);
+  for (auto& idle : classes_)
+    idle.clear();
+}
+
+VmoPool::Stats VmoPool::stats() const {
+  ftl::MutexLocker locker(&mutex_);
+  return stats_;
+}
+
+}  // namespace mtl
@@ -0,0 +1,81 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_MTL_VMO_VMO_POOL_H_
+#define LIB_MTL_VMO_VMO_POOL_H_
+
+#include <mx/vmo.h>
+
+#include <vector>
+
+#include "lib/ftl/ftl_export.h"
+#include "lib/ftl/macros.h"
+#include "lib/ftl/synchronization/mutex.h"
+#include "lib/ftl/synchronization/thread_annotations.h"
+
+namespace mtl {
+
+// Recycles VMOs so that services which create many short-lived buffers avoid
+// paying for |mx::vmo::create| and fresh page faults every time.
+//
+// VMOs are kept in power-of-two size classes from one page up to
+// |kMaxPooledSize|. Larger requests are passed straight to the kernel.
+//
+// This object is thread-safe.
+class FTL_EXPORT VmoPool {
+ public:
+  // What the caller expects the contents of an acquired VMO to be.
+  enum class Contents {
+    // All bytes are zero. Recycled VMOs are decommitted first.
+    kZeroed,
+    // The first |size| bytes may hold stale contents, which the caller must
+    // overwrite before sharing the VMO. Recycled VMOs keep their committed
+    // pages. The rest of the last page, which a receiver could still map or
+    // read, is zeroed.
+    kUninitialized,
+  };
+
+  struct Stats {
+    // Acquisitions satisfied from the pool.
+    uint64_t hits = 0u;
+    // Acquisitions which had to create a new VMO.
+    uint64_t misses = 0u;
+    // Recycled VMOs which were dropped because their class was full or they
+    // were too large to pool.
+    uint64_t discarded = 0u;
+  };
+
+  static constexpr uint64_t kMaxPooledSize = 16u * 1024u * 1024u;
+
+  // |max_vmos_per_class| bounds the number of idle VMOs kept in each size
+  // class.
+  explicit VmoPool(size_t max_vmos_per_class = 16u);
+  ~VmoPool();
+
+  // Sets |vmo_ptr| to a VMO whose size is exactly |size|.
+  // Returns false if a VMO could not be created.
+  bool Acquire(uint64_t size, Contents contents, mx::vmo* vmo_ptr);
+
+  // Returns |vmo| to the pool for reuse. The caller must not have shared the
+  // VMO with anyone else, since its contents will be handed out again.
+  void Recycle(mx::vmo vmo);
+
+  // Drops all idle VMOs.
+  void Clear();
+
+  Stats stats() const;
+
+ private:
+  const size_t max_vmos_per_class_;
+
+  mutable ftl::Mutex mutex_;
+  std::vector<std::vector<mx::vmo>> classes_ FTL_GUARDED_BY(mutex_);
+  Stats stats_ FTL_GUARDED_BY(mutex_);
+
+  FTL_DISALLOW_COPY_AND_ASSIGN(VmoPool);
+};
+
+}  // namespace mtl
+
+#endif  // LIB_MTL_VMO_VMO_POOL_H_
@@ -0,0 +1,119 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/vmo/vmo_pool.h"
+
+#include <mx/vmar.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "lib/mtl/vmo/strings.h"
+#include "lib/mtl/vmo/vector.h"
+
+namespace mtl {
+namespace {
+
+TEST(VmoPool, RecyclesWithinSizeClass) {
+  VmoPool pool;
+  mx::vmo vmo;
+  ASSERT_TRUE(pool.Acquire(3000u, VmoPool::Contents::kZeroed, &vmo));
+  mx_handle_t handle = vmo.get();
+  pool.Recycle(std::move(vmo));
+
+  ASSERT_TRUE(pool.Acquire(4000u, VmoPool::Contents::kZeroed, &vmo));
+  EXPECT_EQ(handle, vmo.get());
+  uint64_t size = 0u;
+  EXPECT_EQ(MX_OK, vmo.get_size(&size));
+  EXPECT_EQ(4000u, size);
+
+  VmoPool::Stats stats = pool.stats();
+  EXPECT_EQ(1u, stats.hits);
+  EXPECT_EQ(1u, stats.misses);
+  EXPECT_EQ(0u, stats.discarded);
+}
+
+TEST(VmoPool, DifferentSizeClassMisses) {
+  VmoPool pool;
+  mx::vmo vmo;
+  ASSERT_TRUE(pool.Acquire(100u, VmoPool::Contents::kZeroed, &vmo));
+  pool.Recycle(std::move(vmo));
+
+  ASSERT_TRUE(pool.Acquire(100000u, VmoPool::Contents::kZeroed, &vmo));
+  EXPECT_EQ(0u, pool.stats().hits);
+  EXPECT_EQ(2u, pool.stats().misses);
+}
+
+TEST(VmoPool, ZeroedContents) {
+  VmoPool pool;
+  mx::vmo vmo;
+  ASSERT_TRUE(VmoFromString("hello", &pool, &vmo));
+  pool.Recycle(std::move(vmo));
+
+  ASSERT_TRUE(pool.Acquire(5u, VmoPool::Contents::kZeroed, &vmo));
+  std::string content;
+  EXPECT_TRUE(StringFromVmo(vmo, &content));
+  EXPECT_EQ(std::string(5u, '\0'), content);
+}
+
+TEST(VmoPool, UninitializedContentsZeroPageTail) {
+  VmoPool pool;
+  mx::vmo vmo;
+  ASSERT_TRUE(pool.Acquire(4096u, VmoPool::Contents::kUninitialized, &vmo));
+  const std::string stale(4096u, '\xff');
+  size_t actual = 0u;
+  ASSERT_EQ(MX_OK, vmo.write(stale.data(), 0u, stale.size(), &actual));
+  pool.Recycle(std::move(vmo));
+
+  ASSERT_TRUE(pool.Acquire(10u, VmoPool::Contents::kUninitialized, &vmo));
+  EXPECT_EQ(1u, pool.stats().hits);
+
+  // A receiver which maps the whole page must not see the earlier payload.
+  uintptr_t address = 0u;
+  ASSERT_EQ(MX_OK, mx::vmar::root_self().map(0u, vmo, 0u, 4096u,
+                                             MX_VM_FLAG_PERM_READ, &address));
+  const char* data = reinterpret_cast<const char*>(address);
+  EXPECT_EQ(std::string(4086u, '\0'), std::string(data + 10u, 4086u));
+  EXPECT_EQ(MX_OK, mx::vmar::root_self().unmap(address, 4096u));
+}
+
+TEST(VmoPool, BoundsIdleVmos) {
+  VmoPool pool(1u);
+  mx::vmo first, second;
+  ASSERT_TRUE(pool.Acquire(10u, VmoPool::Contents::kZeroed, &first));
+  ASSERT_TRUE(pool.Acquire(10u, VmoPool::Contents::kZeroed, &second));
+  pool.Recycle(std::move(first));
+  pool.Recycle(std::move(second));
+  EXPECT_EQ(1u, pool.stats().discarded);
+
+  mx::vmo large;
+  ASSERT_TRUE(pool.Acquire(VmoPool::kMaxPooledSize + 1u,
+                           VmoPool::Contents::kZeroed, &large));
+  pool.Recycle(std::move(large));
+  EXPECT_EQ(2u, pool.stats().discarded);
+}
+
+TEST(VmoPool, VmoFromContainers) {
+  VmoPool pool;
+  mx::vmo vmo;
+  ASSERT_TRUE(VmoFromString("Hello, world.", &pool, &vmo));
+  pool.Recycle(std::move(vmo));
+
+  ASSERT_TRUE(VmoFromVector(std::vector<char>(5u, 'x'), &pool, &vmo));
+  std::string content;
+  EXPECT_TRUE(StringFromVmo(vmo, &content));
+  EXPECT_EQ("xxxxx", content);
+  pool.Recycle(std::move(vmo));
+  EXPECT_EQ(1u, pool.stats().hits);
+
+  // Large payloads take the mapped path.
+  std::vector<char> v(200000u, 'v');
+  ASSERT_TRUE(VmoFromVector(v, &pool, &vmo));
+  std::vector<char> v_out;
+  EXPECT_TRUE(VectorFromVmo(vmo, &v_out));
+  EXPECT_EQ(v, v_out);
+}
+
+}  // namespace
+}  // namespace mtl
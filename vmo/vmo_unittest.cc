@@ -0,0 +1,51 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "lib/mtl/vmo/vmo.h"
+
+#include <string.h>
+
+#include "gtest/gtest.h"
+#include "lib/mtl/vmo/strings.h"
+
+namespace mtl {
+namespace {
+
+TEST(VmoFromCallback, FillsContents) {
+  mx::vmo vmo;
+  EXPECT_TRUE(VmoFromCallback(5u,
+                              [](void* data) {
+                                memcpy(data, "Hello", 5u);
+                                return true;
+                              },
+                              &vmo));
+  std::string out;
+  EXPECT_TRUE(StringFromVmo(vmo, &out));
+  EXPECT_EQ("Hello", out);
+}
+
+TEST(VmoFromCallback, Empty) {
+  bool called = false;
+  mx::vmo vmo;
+  EXPECT_TRUE(VmoFromCallback(0u,
+                              [&called](void* data) {
+                                called = true;
+                                return true;
+                              },
+                              &vmo));
+  EXPECT_FALSE(called);
+  uint64_t size = 1u;
+  EXPECT_EQ(MX_OK, vmo.get_size(&size));
+  EXPECT_EQ(0u, size);
+}
+
+TEST(VmoFromCallback, FillFails) {
+  mx::vmo vmo;
+  EXPECT_FALSE(
+      VmoFromCallback(16u, [](void* data) { return false; }, &vmo));
+  EXPECT_FALSE(vmo);
+}
+
+}  // namespace
+}  // namespace mtl
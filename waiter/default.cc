@@ -15,22 +15,28 @@ class HandleWatcher : public MessageLoopHandler {
   HandleWatcher(mx_handle_t handle,
                 FidlAsyncWaitCallback callback,
                 void* context)
-      : key_(0), handle_(handle), callback_(callback), context_(context) {}
+      : message_loop_(nullptr),
+        key_(0),
+        handle_(handle),
+        callback_(callback),
+        context_(context) {}
 
   ~HandleWatcher() {
     if (key_)
-      MessageLoop::GetCurrent()->RemoveHandler(key_);
+      message_loop_->RemoveHandler(key_);
   }
 
-  void Start(mx_signals_t signals, mx_time_t timeout) {
-    MessageLoop* message_loop = MessageLoop::GetCurrent();
+  void Start(MessageLoop* message_loop,
+             mx_signals_t signals,
+             mx_time_t timeout) {
     FTL_DCHECK(message_loop) << "DefaultAsyncWaiter requires a MessageLoop";
+    message_loop_ = message_loop;
     ftl::TimeDelta timeout_delta;
     if (timeout == MX_TIME_INFINITE)
       timeout_delta = ftl::TimeDelta::Max();
     else
       timeout_delta = ftl::TimeDelta::FromNanoseconds(timeout);
-    key_ = message_loop->AddHandler(this, handle_, signals, timeout_delta);
+    key_ = message_loop_->AddHandler(this, handle_, signals, timeout_delta);
   }
 
  protected:
@@ -52,6 +58,8 @@ class HandleWatcher : public MessageLoopHandler {
     callback(status, pending, count, context);
   }
 
+  // Remembered so that cancellation does not look the loop up again.
+  MessageLoop* message_loop_;
   MessageLoop::HandlerKey key_;
   mx_handle_t handle_;
   FidlAsyncWaitCallback callback_;
@@ -67,7 +75,7 @@ FidlAsyncWaitID AsyncWait(mx_handle_t handle,
                           void* context) {
   // This instance will be deleted when done or cancelled.
   HandleWatcher* watcher = new HandleWatcher(handle, callback, context);
-  watcher->Start(signals, timeout);
+  watcher->Start(MessageLoop::GetCurrent(), signals, timeout);
   return reinterpret_cast<FidlAsyncWaitID>(watcher);
 }
 